@@ -0,0 +1,261 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __ACTIVATION__
+#define __ACTIVATION__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace mml
+{
+
+// Floating point layout used to build 2^n from bits
+// Terms is the taylor degree of exp on |r| <= ln(2)/2 and of the atanh series for log on |s| <= 0.172
+template <typename T>
+struct activation_traits;
+template <>
+struct activation_traits<double>
+{
+    typedef uint64_t bits;
+    static constexpr unsigned mantissa = 52;
+    static constexpr bits bias = 1023;
+    static constexpr double shift = 6755399441055744.0;
+    static constexpr double max_arg = 708.0;
+    static constexpr unsigned exp_terms = 13;
+    static constexpr unsigned log_terms = 10;
+};
+template <>
+struct activation_traits<float>
+{
+    typedef uint32_t bits;
+    static constexpr unsigned mantissa = 23;
+    static constexpr bits bias = 127;
+    static constexpr float shift = 12582912.0f;
+    static constexpr float max_arg = 87.0f;
+    static constexpr unsigned exp_terms = 7;
+    static constexpr unsigned log_terms = 4;
+};
+
+// Returns a if c else b through bit masks
+// GCC keeps a branch for a floating point ternary feeding arithmetic unless -fno-trapping-math, which stops vectorization
+template <typename T>
+inline T act_select(const bool c, const T a, const T b)
+{
+    typedef typename activation_traits<T>::bits bits;
+    bits ab, bb;
+    std::memcpy(&ab, &a, sizeof(T));
+    std::memcpy(&bb, &b, sizeof(T));
+    const bits mask = static_cast<bits>(0) - static_cast<bits>(c);
+    const bits rb = (ab & mask) | (bb & ~mask);
+    T out;
+    std::memcpy(&out, &rb, sizeof(T));
+    return out;
+}
+// k! evaluated at compile time for polynomial coefficients
+template <typename T>
+constexpr T act_factorial(const unsigned k)
+{
+    return (k <= 1) ? static_cast<T>(1.0) : k * act_factorial<T>(k - 1);
+}
+// Horner's rule for the taylor series of exp, sum r^k / k! for k in [K, N]
+// Coefficients are compile time constants so each term is one fused multiply add
+template <typename T, unsigned K, unsigned N>
+struct act_exp_series
+{
+    inline static T eval(const T r)
+    {
+        constexpr T c = static_cast<T>(1.0) / act_factorial<T>(K);
+        return c + r * act_exp_series<T, K + 1, N>::eval(r);
+    }
+};
+template <typename T, unsigned N>
+struct act_exp_series<T, N, N>
+{
+    inline static T eval(const T r)
+    {
+        constexpr T c = static_cast<T>(1.0) / act_factorial<T>(N);
+        return c;
+    }
+};
+// Horner's rule for the atanh series, sum s2^k / (2k + 1) for k in [K, N]
+template <typename T, unsigned K, unsigned N>
+struct act_atanh_series
+{
+    inline static T eval(const T s2)
+    {
+        constexpr T c = static_cast<T>(1.0) / (2 * K + 1);
+        return c + s2 * act_atanh_series<T, K + 1, N>::eval(s2);
+    }
+};
+template <typename T, unsigned N>
+struct act_atanh_series<T, N, N>
+{
+    inline static T eval(const T s2)
+    {
+        constexpr T c = static_cast<T>(1.0) / (2 * N + 1);
+        return c;
+    }
+};
+// Branchless exp(x), x is clamped to the normal range of T
+// Relative error is below 1E-13 for double and 1E-6 for float, every step is a select or polynomial so loops over buffers auto vectorize
+template <typename T>
+inline T act_exp(const T x)
+{
+    typedef activation_traits<T> traits;
+    typedef typename traits::bits bits;
+    static_assert(std::is_floating_point<T>::value, "act_exp: T must be float or double");
+
+    // Range reduction, x = n * ln(2) + r, ln(2) split in two for an exact product with n
+    const T high = traits::max_arg;
+    const T low = -high;
+    const T c = act_select<T>(x < low, low, act_select<T>(x > high, high, x));
+    const T n = std::nearbyint(c * static_cast<T>(1.4426950408889634));
+    const T r = (c - n * static_cast<T>(0.693145751953125)) - n * static_cast<T>(1.4286068203094172321E-6);
+
+    // Taylor series of exp(r)
+    const T p = act_exp_series<T, 0, traits::exp_terms>::eval(r);
+
+    // 2^n from bits, n + shift places the integer n in the low mantissa bits
+    const T m = n + traits::shift;
+    const T s = traits::shift;
+    bits mb, sb;
+    std::memcpy(&mb, &m, sizeof(T));
+    std::memcpy(&sb, &s, sizeof(T));
+    const bits eb = (mb - sb + traits::bias) << traits::mantissa;
+    T scale;
+    std::memcpy(&scale, &eb, sizeof(T));
+
+    return p * scale;
+}
+// Branchless log(x) for x in [1, 2]
+template <typename T>
+inline T act_log_1_2(const T x)
+{
+    typedef activation_traits<T> traits;
+    static_assert(std::is_floating_point<T>::value, "act_log_1_2: T must be float or double");
+
+    // Reduce x onto [sqrt(2) / 2, sqrt(2)]
+    const bool high = x > static_cast<T>(1.4142135623730951);
+    const T m = act_select<T>(high, x * static_cast<T>(0.5), x);
+    const T e = act_select<T>(high, static_cast<T>(0.6931471805599453), static_cast<T>(0.0));
+
+    // log(m) = 2 * atanh(s), s = (m - 1) / (m + 1)
+    const T s = (m - 1.0) / (m + 1.0);
+    const T p = act_atanh_series<T, 0, traits::log_terms - 1>::eval(s * s);
+
+    return e + 2.0 * s * p;
+}
+// 1 / (1 + exp(-x)), the clamp in act_exp saturates to 1 and to below 1E-300 without a select
+template <typename T>
+inline T act_sigmoid(const T x)
+{
+    return 1.0 / (1.0 + act_exp<T>(-x));
+}
+// 2 / (1 + exp(-2x)) - 1, rounds to exactly -1 and 1 for large |x|
+template <typename T>
+inline T act_tanh(const T x)
+{
+    return (2.0 / (1.0 + act_exp<T>(-2.0 * x))) - 1.0;
+}
+// log(1 + exp(x)) = max(x, 0) + log(1 + exp(-|x|)), does not overflow for large x
+template <typename T>
+inline T act_softplus(const T x)
+{
+    const T a = std::abs(x);
+    const T z = act_select<T>(x > 0.0, x, static_cast<T>(0.0));
+    return z + act_log_1_2<T>(1.0 + act_exp<T>(-a));
+}
+// max(x, 0)
+template <typename T>
+inline T act_relu(const T x)
+{
+    return (x > 0.0) ? x : static_cast<T>(0.0);
+}
+// x for positive x, 0.01 * x otherwise
+template <typename T>
+inline T act_leaky_relu(const T x)
+{
+    return act_select<T>(x > 0.0, x, static_cast<T>(0.01) * x);
+}
+// Tanh approximation of x * P(X <= x) for standard normal X
+template <typename T>
+inline T act_gelu(const T x)
+{
+    const T u = static_cast<T>(0.7978845608028654) * (x + static_cast<T>(0.044715) * x * x * x);
+    return 0.5 * x * (1.0 + act_tanh<T>(u));
+}
+// Buffer versions apply the activation in place to a whole layer
+template <typename T>
+inline void act_exp(T *x, const size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        x[i] = act_exp<T>(x[i]);
+    }
+}
+template <typename T>
+inline void act_gelu(T *x, const size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        x[i] = act_gelu<T>(x[i]);
+    }
+}
+template <typename T>
+inline void act_leaky_relu(T *x, const size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        x[i] = act_leaky_relu<T>(x[i]);
+    }
+}
+template <typename T>
+inline void act_relu(T *x, const size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        x[i] = act_relu<T>(x[i]);
+    }
+}
+template <typename T>
+inline void act_sigmoid(T *x, const size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        x[i] = act_sigmoid<T>(x[i]);
+    }
+}
+template <typename T>
+inline void act_softplus(T *x, const size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        x[i] = act_softplus<T>(x[i]);
+    }
+}
+template <typename T>
+inline void act_tanh(T *x, const size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        x[i] = act_tanh<T>(x[i]);
+    }
+}
+} // namespace mml
+
+#endif
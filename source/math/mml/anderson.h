@@ -0,0 +1,218 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __ANDERSON__
+#define __ANDERSON__
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mml/vec.h>
+
+namespace mml
+{
+
+// Type-II Anderson acceleration of the fixed point iteration x = G(x) with a history window of H
+template <typename T, size_t N, size_t H = 5>
+class anderson
+{
+  private:
+    std::function<vector<T, N>(const vector<T, N> &)> _g;
+    size_t _max_iterations;
+    T _tolerance;
+    T _damping;
+    T _safeguard;
+    size_t _evaluations;
+
+    // Differences of residuals and G values, ordered oldest to newest
+    vector<T, N> _df[H];
+    vector<T, N> _dg[H];
+    size_t _size;
+
+    inline void drop_oldest()
+    {
+        // Shift history left by one
+        const size_t m = std::min(_size, H);
+        for (size_t i = 1; i < m; i++)
+        {
+            _df[i - 1] = _df[i];
+            _dg[i - 1] = _dg[i];
+        }
+        _size--;
+    }
+    inline void push(const vector<T, N> &df, const vector<T, N> &dg)
+    {
+        // Drop oldest column if window is full
+        if (_size == H)
+        {
+            drop_oldest();
+        }
+        _df[_size] = df;
+        _dg[_size] = dg;
+        _size++;
+    }
+    // Solves min |f - dF * gamma| by modified gram-schmidt QR, drops old columns while R is ill-conditioned
+    inline void least_squares(const vector<T, N> &f, T gamma[H])
+    {
+        vector<T, N> q[H];
+        T r[H][H];
+        size_t m = std::min(_size, H);
+        while (m > 0)
+        {
+            // Factor dF = Q * R
+            for (size_t j = 0; j < m; j++)
+            {
+                q[j] = _df[j];
+                for (size_t i = 0; i < j; i++)
+                {
+                    r[i][j] = q[i].dot(q[j]);
+                    q[j] -= q[i] * r[i][j];
+                }
+                r[j][j] = std::sqrt(q[j].square_magnitude());
+                if (r[j][j] > 0.0)
+                {
+                    q[j] = q[j] * (1.0 / r[j][j]);
+                }
+            }
+
+            // Estimate condition number from the diagonal of R
+            T r_max = 0.0;
+            T r_min = std::numeric_limits<T>::max();
+            for (size_t j = 0; j < m; j++)
+            {
+                r_max = std::max(r_max, r[j][j]);
+                r_min = std::min(r_min, r[j][j]);
+            }
+            if (r_min > 1E-10 * r_max)
+            {
+                break;
+            }
+
+            // Ill-conditioned, drop the oldest difference and refactor
+            drop_oldest();
+            m = std::min(_size, H);
+        }
+
+        // Back substitution of R * gamma = Q^T * f
+        for (size_t i = m; i-- > 0;)
+        {
+            T sum = q[i].dot(f);
+            for (size_t j = i + 1; j < m; j++)
+            {
+                sum -= r[i][j] * gamma[j];
+            }
+            gamma[i] = sum / r[i][i];
+        }
+    }
+
+  public:
+    anderson(const std::function<vector<T, N>(const vector<T, N> &)> &g)
+        : _g(g), _max_iterations(100), _tolerance(1E-8), _damping(1.0), _safeguard(1E4), _evaluations(0), _size(0)
+    {
+        // Assert history window is not empty
+        static_assert(H > 0, "anderson: history window must be at least one");
+    }
+    // Number of G evaluations used by the last call to solve
+    inline size_t get_evaluations() const
+    {
+        return _evaluations;
+    }
+    inline void set_damping(const T damping)
+    {
+        _damping = damping;
+    }
+    inline void set_max_iterations(const size_t iterations)
+    {
+        _max_iterations = iterations;
+    }
+    inline void set_safeguard(const T safeguard)
+    {
+        _safeguard = safeguard;
+    }
+    inline void set_tolerance(const T tolerance)
+    {
+        _tolerance = tolerance;
+    }
+    // Finds x = G(x), returns |G(x1) - x1|^2 which should be close to zero at the fixed point
+    inline T solve(const vector<T, N> &x0, vector<T, N> &x1)
+    {
+        // Clear history
+        _size = 0;
+        _evaluations = 0;
+
+        // Evaluate starting point
+        x1 = x0;
+        vector<T, N> g = _g(x1);
+        vector<T, N> f = g - x1;
+        T convergence = f.square_magnitude();
+        _evaluations++;
+
+        // Iterate with one evaluation of G per iteration
+        for (size_t i = 0; i < _max_iterations; i++)
+        {
+            // Determine if we have converged
+            if (convergence < _tolerance)
+            {
+                return convergence;
+            }
+
+            // Damped picard step
+            vector<T, N> x = x1 + f * _damping;
+
+            // Accelerate with the history of differences
+            if (_size > 0)
+            {
+                T gamma[H];
+                least_squares(f, gamma);
+                for (size_t j = 0; j < _size; j++)
+                {
+                    // x = x1 + beta * f - (dX + beta * dF) * gamma, with dX = dG - dF
+                    x -= (_dg[j] - _df[j] + _df[j] * _damping) * gamma[j];
+                }
+            }
+
+            // Evaluate next point
+            const vector<T, N> g_next = _g(x);
+            const vector<T, N> f_next = g_next - x;
+            const T next = f_next.square_magnitude();
+            _evaluations++;
+
+            // Safeguard, restart from a plain damped picard step if acceleration blew up the residual
+            if (_size > 0 && next > _safeguard * convergence)
+            {
+                _size = 0;
+                x1 = x1 + f * _damping;
+                g = _g(x1);
+                f = g - x1;
+                convergence = f.square_magnitude();
+                _evaluations++;
+                continue;
+            }
+
+            // Record differences and advance
+            push(f_next - f, g_next - g);
+            x1 = x;
+            g = g_next;
+            f = f_next;
+            convergence = next;
+        }
+
+        // Return the squared residual of the last iterate
+        return convergence;
+    }
+};
+} // namespace mml
+
+#endif
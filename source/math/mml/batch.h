@@ -0,0 +1,757 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __BATCH__
+#define __BATCH__
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mml/equation.h>
+#include <mml/mat.h>
+#include <mml/vec.h>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace mml
+{
+
+// Batches store W independent problems structure of arrays, lane index is innermost
+// Every kernel loops over lanes last with selects instead of branches so it auto vectorizes
+template <typename T, size_t N, size_t W>
+class vector_batch
+{
+  private:
+    T _vec[N][W];
+
+  public:
+    vector_batch()
+    {
+        zero();
+    }
+    vector_batch(const T value)
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            for (size_t l = 0; l < W; l++)
+            {
+                _vec[i][l] = value;
+            }
+        }
+    }
+    inline const T *operator[](const size_t index) const
+    {
+        return _vec[index];
+    }
+    inline T *operator[](const size_t index)
+    {
+        return _vec[index];
+    }
+    inline vector<T, N> get(const size_t lane) const
+    {
+        vector<T, N> out;
+
+        // Gather lane into a vector
+        for (size_t i = 0; i < N; i++)
+        {
+            out[i] = _vec[i][lane];
+        }
+
+        return out;
+    }
+    inline void set(const size_t lane, const vector<T, N> &v)
+    {
+        // Scatter vector into lane
+        for (size_t i = 0; i < N; i++)
+        {
+            _vec[i][lane] = v[i];
+        }
+    }
+    inline vector<T, W> square_magnitude() const
+    {
+        vector<T, W> out;
+
+        // Per lane sum of squares
+        for (size_t i = 0; i < N; i++)
+        {
+            for (size_t l = 0; l < W; l++)
+            {
+                out[l] += _vec[i][l] * _vec[i][l];
+            }
+        }
+
+        return out;
+    }
+    inline void zero()
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            for (size_t l = 0; l < W; l++)
+            {
+                _vec[i][l] = 0.0;
+            }
+        }
+    }
+};
+
+// Forward declaration of lu_batch
+template <typename T, size_t N, size_t W>
+class lu_batch;
+
+template <typename T, size_t R, size_t C, size_t W>
+class matrix_batch
+{
+    friend class lu_batch<T, R, W>;
+
+  private:
+    T _mat[R][C][W];
+
+    // One column of the batched LU factorization, K is a template so every row index is constant
+    // Rows are swapped in place per lane with arithmetic selects, piv[K] records the row swapped with row K
+    template <size_t K>
+    inline void column(std::integral_constant<size_t, K>, T s[R][W], T piv[R][W], T singular[W])
+    {
+        // Find the pivot row for each lane
+        T max[W];
+        T index[W];
+        for (size_t l = 0; l < W; l++)
+        {
+            max[l] = std::abs(_mat[K][K][l]) * s[K][l];
+            index[l] = K;
+        }
+        for (size_t i = K + 1; i < R; i++)
+        {
+            const T row = i;
+            for (size_t l = 0; l < W; l++)
+            {
+                const T value = std::abs(_mat[i][K][l]) * s[i][l];
+                const T greater = value > max[l];
+                max[l] = std::max(value, max[l]);
+                index[l] += greater * (row - index[l]);
+            }
+        }
+
+        // Swap pivot row into row K
+        for (size_t i = K + 1; i < R; i++)
+        {
+            const T row = i;
+            T swap[W];
+            for (size_t l = 0; l < W; l++)
+            {
+                swap[l] = index[l] == row;
+            }
+            for (size_t j = 0; j < C; j++)
+            {
+                for (size_t l = 0; l < W; l++)
+                {
+                    const T d = swap[l] * (_mat[i][j][l] - _mat[K][j][l]);
+                    _mat[K][j][l] += d;
+                    _mat[i][j][l] -= d;
+                }
+            }
+            for (size_t l = 0; l < W; l++)
+            {
+                const T d = swap[l] * (s[i][l] - s[K][l]);
+                s[K][l] += d;
+                s[i][l] -= d;
+            }
+        }
+
+        // Flag singular lanes, the true pivot is kept so the determinant stays exact
+        T inv[W];
+        for (size_t l = 0; l < W; l++)
+        {
+            piv[K][l] = index[l];
+            singular[l] = std::max(singular[l], static_cast<T>(max[l] < 1E-4));
+
+            // A zero pivot column needs no elimination, avoid dividing by zero
+            const T zero = _mat[K][K][l] == 0.0;
+            inv[l] = (1.0 - zero) / (_mat[K][K][l] + zero);
+        }
+
+        // Eliminate below the pivot
+        for (size_t i = K + 1; i < R; i++)
+        {
+            T factor[W];
+            for (size_t l = 0; l < W; l++)
+            {
+                factor[l] = _mat[i][K][l] * inv[l];
+                _mat[i][K][l] = factor[l];
+            }
+            for (size_t j = K + 1; j < C; j++)
+            {
+                for (size_t l = 0; l < W; l++)
+                {
+                    _mat[i][j][l] -= factor[l] * _mat[K][j][l];
+                }
+            }
+        }
+
+        // Factor next column
+        column(std::integral_constant<size_t, K + 1>(), s, piv, singular);
+    }
+    inline void column(std::integral_constant<size_t, R>, T[R][W], T[R][W], T[W]) {}
+    // Batched LU factorization with scaled partial pivoting
+    inline void decompose(T piv[R][W], T singular[W])
+    {
+        // Inverse row scale factors
+        T s[R][W];
+        for (size_t i = 0; i < R; i++)
+        {
+            for (size_t l = 0; l < W; l++)
+            {
+                s[i][l] = std::numeric_limits<T>::min();
+            }
+            for (size_t j = 0; j < C; j++)
+            {
+                for (size_t l = 0; l < W; l++)
+                {
+                    s[i][l] = std::max(s[i][l], std::abs(_mat[i][j][l]));
+                }
+            }
+            for (size_t l = 0; l < W; l++)
+            {
+                s[i][l] = 1.0 / s[i][l];
+            }
+        }
+        for (size_t l = 0; l < W; l++)
+        {
+            singular[l] = 0.0;
+        }
+
+        // Factor all columns
+        column(std::integral_constant<size_t, 0>(), s, piv, singular);
+    }
+    inline void substitute(const T piv[R][W], vector_batch<T, C, W> &v) const
+    {
+        // Stage right hand side in a local so loads and stores never alias the factors
+        T x[R][W];
+        for (size_t i = 0; i < R; i++)
+        {
+            for (size_t l = 0; l < W; l++)
+            {
+                x[i][l] = v[i][l];
+            }
+        }
+
+        // Apply row swaps
+        for (size_t k = 0; k < R; k++)
+        {
+            T next[W];
+            for (size_t l = 0; l < W; l++)
+            {
+                next[l] = x[k][l];
+            }
+            for (size_t i = k + 1; i < R; i++)
+            {
+                const T row = i;
+                for (size_t l = 0; l < W; l++)
+                {
+                    const T d = (piv[k][l] == row) * (x[i][l] - x[k][l]);
+                    next[l] += d;
+                    x[i][l] -= d;
+                }
+            }
+            for (size_t l = 0; l < W; l++)
+            {
+                x[k][l] = next[l];
+            }
+        }
+
+        // Forward substitution
+        for (size_t i = 1; i < R; i++)
+        {
+            T sum[W];
+            for (size_t l = 0; l < W; l++)
+            {
+                sum[l] = x[i][l];
+            }
+            for (size_t j = 0; j < i; j++)
+            {
+                for (size_t l = 0; l < W; l++)
+                {
+                    sum[l] -= _mat[i][j][l] * x[j][l];
+                }
+            }
+            for (size_t l = 0; l < W; l++)
+            {
+                x[i][l] = sum[l];
+            }
+        }
+
+        // Back substitution
+        for (size_t i = R; i-- > 0;)
+        {
+            T sum[W];
+            for (size_t l = 0; l < W; l++)
+            {
+                sum[l] = x[i][l];
+            }
+            for (size_t j = i + 1; j < C; j++)
+            {
+                for (size_t l = 0; l < W; l++)
+                {
+                    sum[l] -= _mat[i][j][l] * x[j][l];
+                }
+            }
+            for (size_t l = 0; l < W; l++)
+            {
+                const T zero = _mat[i][i][l] == 0.0;
+                x[i][l] = sum[l] * (1.0 - zero) / (_mat[i][i][l] + zero);
+            }
+        }
+
+        // Copy solution out
+        for (size_t i = 0; i < R; i++)
+        {
+            for (size_t l = 0; l < W; l++)
+            {
+                v[i][l] = x[i][l];
+            }
+        }
+    }
+
+  public:
+    matrix_batch()
+    {
+        // Identity in every lane
+        for (size_t i = 0; i < R; i++)
+        {
+            for (size_t j = 0; j < C; j++)
+            {
+                for (size_t l = 0; l < W; l++)
+                {
+                    _mat[i][j][l] = (i == j) ? 1.0 : 0.0;
+                }
+            }
+        }
+    }
+    inline vector<T, W> determinant() const
+    {
+        return lu_batch<T, R, W>(*this).determinant();
+    }
+    inline const T *get(const size_t i, const size_t j) const
+    {
+        return _mat[i][j];
+    }
+    inline T *get(const size_t i, const size_t j)
+    {
+        return _mat[i][j];
+    }
+    inline matrix<T, R, C> get(const size_t lane) const
+    {
+        matrix<T, R, C> out;
+
+        // Gather lane into a matrix
+        for (size_t i = 0; i < R; i++)
+        {
+            for (size_t j = 0; j < C; j++)
+            {
+                out.get(i, j) = _mat[i][j][lane];
+            }
+        }
+
+        return out;
+    }
+    inline void set(const size_t lane, const matrix<T, R, C> &m)
+    {
+        // Scatter matrix into lane
+        for (size_t i = 0; i < R; i++)
+        {
+            for (size_t j = 0; j < C; j++)
+            {
+                _mat[i][j][lane] = m.get(i, j);
+            }
+        }
+    }
+    // Singular lanes are flagged with 1.0 in singular and return a zero inverse
+    inline matrix_batch<T, R, C, W> inverse(vector<T, W> &singular) const
+    {
+        const lu_batch<T, R, W> lu(*this);
+        singular = lu.singular();
+        return lu.inverse();
+    }
+    inline matrix_batch<T, R, C, W> inverse() const
+    {
+        return lu_batch<T, R, W>(*this).inverse();
+    }
+    // This function solves the equations [A]{X} = {B} for every lane
+    // Singular lanes are flagged with 1.0 in singular and return a zero solution
+    inline vector_batch<T, C, W> ludecomp(const vector_batch<T, C, W> &v, vector<T, W> &singular) const
+    {
+        static_assert(R == C, "matrix_batch.ludecomp: matrix is not square!");
+
+        // Make a local copy for manipulating decomposition
+        matrix_batch<T, R, C, W> A = *this;
+        vector_batch<T, C, W> B = v;
+
+        // Perform decomposition and substitution
+        T piv[R][W];
+        T flag[W];
+        A.decompose(piv, flag);
+        A.substitute(piv, B);
+
+        // Zero out singular lanes
+        for (size_t l = 0; l < W; l++)
+        {
+            singular[l] = flag[l];
+        }
+        for (size_t i = 0; i < C; i++)
+        {
+            for (size_t l = 0; l < W; l++)
+            {
+                B[i][l] = (flag[l] > 0.0) ? 0.0 : B[i][l];
+            }
+        }
+
+        return B;
+    }
+    inline vector_batch<T, C, W> ludecomp(const vector_batch<T, C, W> &v) const
+    {
+        vector<T, W> singular;
+        return ludecomp(v, singular);
+    }
+};
+
+// Reusable LU factorization of W small matrices, one matrix per lane
+template <typename T, size_t N, size_t W>
+class lu_batch
+{
+  private:
+    matrix_batch<T, N, N, W> _lu;
+    T _piv[N][W];
+    vector<T, W> _singular;
+
+  public:
+    lu_batch(const matrix_batch<T, N, N, W> &A) : _lu(A)
+    {
+        // Kernels are fully unrolled register sized loops, keep matrices small
+        static_assert(N <= 8, "lu_batch: only matrices up to 8x8 are supported");
+
+        // Factor all lanes
+        T singular[W];
+        _lu.decompose(_piv, singular);
+        for (size_t l = 0; l < W; l++)
+        {
+            _singular[l] = singular[l];
+        }
+    }
+    inline vector<T, W> determinant() const
+    {
+        vector<T, W> out(1.0);
+
+        // Product of pivots
+        for (size_t k = 0; k < N; k++)
+        {
+            const T row = k;
+            for (size_t l = 0; l < W; l++)
+            {
+                // Every row swap flips the sign
+                const T sign = (_piv[k][l] == row) ? 1.0 : -1.0;
+                out[l] *= sign * _lu.get(k, k)[l];
+            }
+        }
+
+        return out;
+    }
+    inline matrix_batch<T, N, N, W> inverse() const
+    {
+        matrix_batch<T, N, N, W> out;
+
+        // Solve for each column of the identity
+        for (size_t j = 0; j < N; j++)
+        {
+            vector_batch<T, N, W> e;
+            for (size_t l = 0; l < W; l++)
+            {
+                e[j][l] = 1.0;
+            }
+            const vector_batch<T, N, W> x = solve(e);
+            for (size_t i = 0; i < N; i++)
+            {
+                for (size_t l = 0; l < W; l++)
+                {
+                    out.get(i, j)[l] = x[i][l];
+                }
+            }
+        }
+
+        return out;
+    }
+    // Lanes with 1.0 failed the relative pivot test of matrix.ludecomp()
+    inline const vector<T, W> &singular() const
+    {
+        return _singular;
+    }
+    // Solve [A]{X} = {B} reusing the factorization, singular lanes return zero
+    inline vector_batch<T, N, W> solve(const vector_batch<T, N, W> &v) const
+    {
+        vector_batch<T, N, W> out = v;
+        _lu.substitute(_piv, out);
+
+        // Zero out singular lanes
+        for (size_t i = 0; i < N; i++)
+        {
+            for (size_t l = 0; l < W; l++)
+            {
+                out[i][l] = (_singular[l] > 0.0) ? 0.0 : out[i][l];
+            }
+        }
+
+        return out;
+    }
+};
+
+// Calls f for every W wide chunk of K matrices, the last chunk is padded with identity matrices
+template <size_t W, typename T, size_t N, typename F>
+inline void for_each_batch(const std::vector<matrix<T, N, N>> &in, const F &f)
+{
+    const size_t size = in.size();
+    for (size_t b = 0; b < size; b += W)
+    {
+        // Pack chunk into lanes
+        matrix_batch<T, N, N, W> A;
+        const size_t lanes = std::min(W, size - b);
+        for (size_t l = 0; l < lanes; l++)
+        {
+            A.set(l, in[b + l]);
+        }
+
+        f(b, lanes, lu_batch<T, N, W>(A));
+    }
+}
+// Computes the determinant of K independent matrices W at a time
+template <size_t W, typename T, size_t N>
+inline std::vector<T> batch_determinant(const std::vector<matrix<T, N, N>> &in)
+{
+    std::vector<T> out(in.size());
+    for_each_batch<W>(in, [&out](const size_t b, const size_t lanes, const lu_batch<T, N, W> &lu) {
+        const vector<T, W> det = lu.determinant();
+        for (size_t l = 0; l < lanes; l++)
+        {
+            out[b + l] = det[l];
+        }
+    });
+
+    return out;
+}
+// Computes the inverse of K independent matrices W at a time
+// Singular matrices are flagged in singular and return zero
+template <size_t W, typename T, size_t N>
+inline std::vector<matrix<T, N, N>> batch_inverse(const std::vector<matrix<T, N, N>> &in, std::vector<bool> &singular)
+{
+    std::vector<matrix<T, N, N>> out(in.size());
+    singular.assign(in.size(), false);
+    for_each_batch<W>(in, [&out, &singular](const size_t b, const size_t lanes, const lu_batch<T, N, W> &lu) {
+        const matrix_batch<T, N, N, W> inv = lu.inverse();
+        for (size_t l = 0; l < lanes; l++)
+        {
+            out[b + l] = inv.get(l);
+            singular[b + l] = lu.singular()[l] > 0.0;
+        }
+    });
+
+    return out;
+}
+template <size_t W, typename T, size_t N>
+inline std::vector<matrix<T, N, N>> batch_inverse(const std::vector<matrix<T, N, N>> &in)
+{
+    std::vector<bool> singular;
+    return batch_inverse<W>(in, singular);
+}
+// Solves K independent systems [A]{X} = {B} W at a time
+// Singular systems are flagged in singular and return zero
+template <size_t W, typename T, size_t N>
+inline std::vector<vector<T, N>> batch_ludecomp(const std::vector<matrix<T, N, N>> &A, const std::vector<vector<T, N>> &B, std::vector<bool> &singular)
+{
+    if (A.size() != B.size())
+    {
+        throw std::runtime_error("batch_ludecomp: matrix and vector counts differ");
+    }
+
+    std::vector<vector<T, N>> out(A.size());
+    singular.assign(A.size(), false);
+    for_each_batch<W>(A, [&B, &out, &singular](const size_t b, const size_t lanes, const lu_batch<T, N, W> &lu) {
+        // Pack right hand sides into lanes
+        vector_batch<T, N, W> v;
+        for (size_t l = 0; l < lanes; l++)
+        {
+            v.set(l, B[b + l]);
+        }
+
+        const vector_batch<T, N, W> x = lu.solve(v);
+        for (size_t l = 0; l < lanes; l++)
+        {
+            out[b + l] = x.get(l);
+            singular[b + l] = lu.singular()[l] > 0.0;
+        }
+    });
+
+    return out;
+}
+template <size_t W, typename T, size_t N>
+inline std::vector<vector<T, N>> batch_ludecomp(const std::vector<matrix<T, N, N>> &A, const std::vector<vector<T, N>> &B)
+{
+    std::vector<bool> singular;
+    return batch_ludecomp<W>(A, B, singular);
+}
+
+// typedef for batched system function pointer, evaluates all N equations in all W lanes
+template <typename T, size_t N, size_t W>
+using batch_function = void (*)(const vector_batch<T, N, W> &, vector_batch<T, N, W> &);
+
+// Newton's method for W independent systems of N equations solved in lockstep
+template <typename T, size_t N, size_t W>
+class batch_system
+{
+  private:
+    std::function<void(const vector_batch<T, N, W> &, vector_batch<T, N, W> &)> _system;
+    size_t _max_iterations;
+    T _tolerance;
+
+  public:
+    batch_system(const batch_function<T, N, W> f)
+        : _system(f), _max_iterations(100), _tolerance(1E-4) {}
+    // Evaluates scalar equations lane by lane, prefer a batch_function for vectorized evaluation
+    template <template <typename, size_t> class numeric>
+    batch_system(const equation<T, N, numeric> eqs[N])
+        : _max_iterations(100), _tolerance(1E-4)
+    {
+        // Copy all functions
+        const std::vector<equation<T, N, numeric>> system(eqs, eqs + N);
+        _system = [system](const vector_batch<T, N, W> &x, vector_batch<T, N, W> &y) {
+            for (size_t l = 0; l < W; l++)
+            {
+                const vector<T, N> xl = x.get(l);
+                for (size_t i = 0; i < N; i++)
+                {
+                    y[i][l] = system[i](xl);
+                }
+            }
+        };
+    }
+    // Center difference jacobian in every lane
+    inline matrix_batch<T, N, N, W> jacobian(const vector_batch<T, N, W> &x, const T dx) const
+    {
+        matrix_batch<T, N, N, W> out;
+        const T inv_2dx = 0.5 / dx;
+
+        // Perturb one variable in all lanes at a time
+        vector_batch<T, N, W> xp = x;
+        vector_batch<T, N, W> xm = x;
+        vector_batch<T, N, W> yp;
+        vector_batch<T, N, W> ym;
+        for (size_t j = 0; j < N; j++)
+        {
+            for (size_t l = 0; l < W; l++)
+            {
+                xp[j][l] = x[j][l] + dx;
+                xm[j][l] = x[j][l] - dx;
+            }
+            _system(xp, yp);
+            _system(xm, ym);
+            for (size_t i = 0; i < N; i++)
+            {
+                for (size_t l = 0; l < W; l++)
+                {
+                    out.get(i, j)[l] = (yp[i][l] - ym[i][l]) * inv_2dx;
+                }
+            }
+            for (size_t l = 0; l < W; l++)
+            {
+                xp[j][l] = x[j][l];
+                xm[j][l] = x[j][l];
+            }
+        }
+
+        return out;
+    }
+    inline vector_batch<T, N, W> evaluate(const vector_batch<T, N, W> &x) const
+    {
+        vector_batch<T, N, W> out;
+
+        // Evaluate all functions in all lanes
+        _system(x, out);
+
+        return out;
+    }
+    inline void set_max_iterations(const size_t iterations)
+    {
+        _max_iterations = iterations;
+    }
+    inline void set_tolerance(const T tolerance)
+    {
+        _tolerance = tolerance;
+    }
+    // Uses Newton's Method to find roots of every lane, returns the per lane convergence
+    // Converged lanes are frozen, lanes with a singular jacobian stop and keep their last iterate
+    inline vector<T, W> zero(const vector_batch<T, N, W> &x0, vector_batch<T, N, W> &x1) const
+    {
+        // Start searching for all equations = 0
+        x1 = x0;
+
+        // Per lane convergence and done mask
+        vector<T, W> convergence;
+        vector<T, W> done;
+        vector<T, W> singular;
+
+        // Search for up to _max_iterations
+        for (size_t it = 0; it < _max_iterations; it++)
+        {
+            // Evaluate the system of equations at x1
+            const vector_batch<T, N, W> y = evaluate(x1);
+
+            // Calculate the convergence criteria and update mask
+            convergence = y.square_magnitude();
+            T active = 0.0;
+            for (size_t l = 0; l < W; l++)
+            {
+                done[l] = (convergence[l] < _tolerance) ? 1.0 : done[l];
+                active += 1.0 - done[l];
+            }
+
+            // Determine if all lanes have converged
+            if (active < 0.5)
+            {
+                break;
+            }
+
+            // Calculate the next step of iteration in every lane
+            const vector_batch<T, N, W> step = jacobian(x1, _tolerance).ludecomp(y, singular);
+
+            // Step active lanes to next iteration
+            for (size_t i = 0; i < N; i++)
+            {
+                for (size_t l = 0; l < W; l++)
+                {
+                    x1[i][l] -= (1.0 - done[l]) * step[i][l];
+                }
+            }
+
+            // Singular lanes can not make progress
+            for (size_t l = 0; l < W; l++)
+            {
+                done[l] = (singular[l] > 0.0) ? 1.0 : done[l];
+            }
+        }
+
+        // Return the per lane sums square of the residuals, should be close to zero at solution
+        return convergence;
+    }
+};
+} // namespace mml
+
+#endif
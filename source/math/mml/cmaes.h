@@ -0,0 +1,401 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __CMAES__
+#define __CMAES__
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mml/equation.h>
+#include <mml/mat.h>
+#include <mml/pool.h>
+#include <mml/vec.h>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace mml
+{
+
+// Covariance matrix adaptation evolution strategy with IPOP restarts
+template <typename T, size_t N, template <typename, size_t> class numeric>
+class cmaes
+{
+  private:
+    typedef std::function<void(const std::vector<vector<T, N>> &, std::vector<T> &)> batch;
+    equation<T, N, numeric> _f;
+    T _sigma;
+    size_t _lambda;
+    size_t _restarts;
+    size_t _evaluations;
+    T _tolerance;
+    size_t _generations;
+    size_t _decompositions;
+    std::mt19937 _rgen;
+    std::normal_distribution<T> _normal;
+
+    // Cyclic jacobi eigendecomposition of symmetric matrix, a = b * diag(d) * b^T
+    inline static void eigen(matrix<T, N, N> a, matrix<T, N, N> &b, vector<T, N> &d)
+    {
+        // Eigenvectors start as identity
+        b = matrix<T, N, N>();
+        for (size_t sweep = 0; sweep < 50; sweep++)
+        {
+            // Sum of off diagonal elements
+            T off = 0.0;
+            for (size_t p = 0; p < N; p++)
+            {
+                for (size_t q = p + 1; q < N; q++)
+                {
+                    off += a.get(p, q) * a.get(p, q);
+                }
+            }
+            if (off < std::numeric_limits<T>::min())
+            {
+                break;
+            }
+
+            // Rotate each off diagonal element to zero
+            for (size_t p = 0; p < N; p++)
+            {
+                for (size_t q = p + 1; q < N; q++)
+                {
+                    const T apq = a.get(p, q);
+                    if (std::abs(apq) < std::numeric_limits<T>::min())
+                    {
+                        continue;
+                    }
+
+                    // Compute rotation angle
+                    const T theta = (a.get(q, q) - a.get(p, p)) / (2.0 * apq);
+                    const T t = std::copysign(1.0, theta) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                    const T c = 1.0 / std::sqrt(t * t + 1.0);
+                    const T s = t * c;
+
+                    // Apply rotation to columns and rows of a
+                    for (size_t k = 0; k < N; k++)
+                    {
+                        const T akp = a.get(k, p);
+                        const T akq = a.get(k, q);
+                        a.get(k, p) = c * akp - s * akq;
+                        a.get(k, q) = s * akp + c * akq;
+                    }
+                    for (size_t k = 0; k < N; k++)
+                    {
+                        const T apk = a.get(p, k);
+                        const T aqk = a.get(q, k);
+                        a.get(p, k) = c * apk - s * aqk;
+                        a.get(q, k) = s * apk + c * aqk;
+                    }
+
+                    // Accumulate eigenvectors
+                    for (size_t k = 0; k < N; k++)
+                    {
+                        const T bkp = b.get(k, p);
+                        const T bkq = b.get(k, q);
+                        b.get(k, p) = c * bkp - s * bkq;
+                        b.get(k, q) = s * bkp + c * bkq;
+                    }
+                }
+            }
+        }
+
+        // Eigenvalues are the diagonal
+        for (size_t i = 0; i < N; i++)
+        {
+            d[i] = a.get(i, i);
+        }
+    }
+    inline T search(const vector<T, N> &x0, vector<T, N> &x1, const batch &eval)
+    {
+        // Best solution over all restarts
+        T best = std::numeric_limits<T>::max();
+        x1 = x0;
+        _generations = 0;
+        _decompositions = 0;
+
+        size_t evaluations = 0;
+        size_t lambda = (_lambda > 0) ? _lambda : 4 + static_cast<size_t>(3.0 * std::log(static_cast<T>(N)));
+        for (size_t r = 0; r <= _restarts && evaluations < _evaluations; r++)
+        {
+            // Recombination weights
+            const size_t mu = lambda / 2;
+            std::vector<T> w(mu);
+            T sum = 0.0;
+            for (size_t i = 0; i < mu; i++)
+            {
+                w[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+                sum += w[i];
+            }
+            T sum2 = 0.0;
+            for (size_t i = 0; i < mu; i++)
+            {
+                w[i] /= sum;
+                sum2 += w[i] * w[i];
+            }
+            const T mueff = 1.0 / sum2;
+
+            // Adaptation constants
+            const T n = static_cast<T>(N);
+            const T cc = (4.0 + mueff / n) / (n + 4.0 + 2.0 * mueff / n);
+            const T cs = (mueff + 2.0) / (n + mueff + 5.0);
+            const T c1 = 2.0 / ((n + 1.3) * (n + 1.3) + mueff);
+            const T cmu = std::min(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) / ((n + 2.0) * (n + 2.0) + mueff));
+            const T damps = 1.0 + 2.0 * std::max(0.0, std::sqrt((mueff - 1.0) / (n + 1.0)) - 1.0) + cs;
+            const T chin = std::sqrt(n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+
+            // Eigendecomposition is updated once every 'lazy' evaluations
+            const size_t lazy = static_cast<size_t>(lambda / ((c1 + cmu) * n * 10.0)) + 1;
+
+            // Initialize strategy state
+            vector<T, N> m = x0;
+            vector<T, N> pc;
+            vector<T, N> ps;
+            matrix<T, N, N> c;
+            matrix<T, N, N> b;
+            matrix<T, N, N> invsqrtc;
+            vector<T, N> d(1.0);
+            T sigma = _sigma;
+            size_t eigen_evaluations = 0;
+            size_t run_evaluations = 0;
+
+            // Population buffers
+            std::vector<vector<T, N>> x(lambda);
+            std::vector<vector<T, N>> y(lambda);
+            std::vector<T> values(lambda);
+            std::vector<size_t> order(lambda);
+
+            // Recent best values for flat fitness detection
+            const size_t history = 10 + static_cast<size_t>(30.0 * n / lambda);
+            std::vector<T> recent;
+
+            for (size_t g = 0; evaluations < _evaluations; g++)
+            {
+                // Sample population, y = B * D * z
+                for (size_t k = 0; k < lambda; k++)
+                {
+                    vector<T, N> z;
+                    for (size_t i = 0; i < N; i++)
+                    {
+                        z[i] = d[i] * _normal(_rgen);
+                    }
+                    y[k] = multiply<T, N, N>(b, z);
+                    x[k] = m + y[k] * sigma;
+                }
+
+                // Evaluate the generation
+                eval(x, values);
+                evaluations += lambda;
+                run_evaluations += lambda;
+                _generations++;
+
+                // Rank samples by fitness
+                for (size_t k = 0; k < lambda; k++)
+                {
+                    order[k] = k;
+                }
+                std::sort(order.begin(), order.end(), [&values](const size_t a, const size_t b) {
+                    return values[a] < values[b];
+                });
+                if (values[order[0]] < best)
+                {
+                    best = values[order[0]];
+                    x1 = x[order[0]];
+                }
+
+                // Weighted recombination of best mu steps
+                vector<T, N> yw;
+                for (size_t i = 0; i < mu; i++)
+                {
+                    yw += y[order[i]] * w[i];
+                }
+                m += yw * sigma;
+
+                // Update evolution paths
+                ps = ps * (1.0 - cs) + multiply<T, N, N>(invsqrtc, yw) * std::sqrt(cs * (2.0 - cs) * mueff);
+                const T psn = std::sqrt(ps.square_magnitude());
+                const bool hsig = psn / std::sqrt(1.0 - std::pow(1.0 - cs, 2.0 * (g + 1))) / chin < 1.4 + 2.0 / (n + 1.0);
+                pc = pc * (1.0 - cc);
+                if (hsig)
+                {
+                    pc += yw * std::sqrt(cc * (2.0 - cc) * mueff);
+                }
+
+                // Rank one and rank mu covariance update
+                const T decay = 1.0 - c1 - cmu + ((hsig) ? 0.0 : c1 * cc * (2.0 - cc));
+                for (size_t i = 0; i < N; i++)
+                {
+                    for (size_t j = 0; j <= i; j++)
+                    {
+                        T rank_mu = 0.0;
+                        for (size_t k = 0; k < mu; k++)
+                        {
+                            const vector<T, N> &yk = y[order[k]];
+                            rank_mu += w[k] * yk[i] * yk[j];
+                        }
+                        const T cij = decay * c.get(i, j) + c1 * pc[i] * pc[j] + cmu * rank_mu;
+                        c.get(i, j) = cij;
+                        c.get(j, i) = cij;
+                    }
+                }
+
+                // Adapt step size
+                sigma *= std::exp((cs / damps) * (psn / chin - 1.0));
+
+                // Lazy eigendecomposition of C
+                if (run_evaluations - eigen_evaluations >= lazy)
+                {
+                    eigen_evaluations = run_evaluations;
+                    eigen(c, b, d);
+                    _decompositions++;
+
+                    // D holds the standard deviations along the principal axes
+                    vector<T, N> inv_d;
+                    for (size_t i = 0; i < N; i++)
+                    {
+                        d[i] = std::sqrt(std::max(d[i], std::numeric_limits<T>::min()));
+                        inv_d[i] = 1.0 / d[i];
+                    }
+
+                    // C^-1/2 = B * D^-1 * B^T
+                    for (size_t i = 0; i < N; i++)
+                    {
+                        for (size_t j = 0; j < N; j++)
+                        {
+                            T sum = 0.0;
+                            for (size_t k = 0; k < N; k++)
+                            {
+                                sum += b.get(i, k) * inv_d[k] * b.get(j, k);
+                            }
+                            invsqrtc.get(i, j) = sum;
+                        }
+                    }
+                }
+
+                // Track recent best values
+                recent.push_back(values[order[0]]);
+                if (recent.size() > history)
+                {
+                    recent.erase(recent.begin());
+                }
+
+                // Stop if step size along all axes is below tolerance
+                const T max_d = *std::max_element(&d[0], &d[0] + N);
+                const T min_d = *std::min_element(&d[0], &d[0] + N);
+                if (sigma * max_d < _tolerance)
+                {
+                    break;
+                }
+
+                // Stop if the fitness range is flat
+                const T range = std::max(*std::max_element(recent.begin(), recent.end()), values[order[lambda - 1]]) - std::min(*std::min_element(recent.begin(), recent.end()), values[order[0]]);
+                if (recent.size() == history && range < _tolerance)
+                {
+                    break;
+                }
+
+                // Stop if the covariance is ill-conditioned
+                if (max_d > 1E7 * min_d)
+                {
+                    break;
+                }
+            }
+
+            // Restart with doubled population
+            lambda *= 2;
+        }
+
+        return best;
+    }
+
+  public:
+    cmaes(const equation<T, N, numeric> &f)
+        : _f(f), _sigma(1.0), _lambda(0), _restarts(9), _evaluations(10000 * N), _tolerance(1E-12), _generations(0), _decompositions(0),
+          _rgen(std::chrono::high_resolution_clock::now().time_since_epoch().count()) {}
+
+    // Returns best f(x) and sets x1, evaluates serially
+    inline T min(const vector<T, N> &x0, vector<T, N> &x1)
+    {
+        const auto eval = [this](const std::vector<vector<T, N>> &x, std::vector<T> &values) {
+            for (size_t i = 0; i < x.size(); i++)
+            {
+                values[i] = _f(x[i]);
+            }
+        };
+
+        return search(x0, x1, eval);
+    }
+    // Returns best f(x) and sets x1, evaluates each generation in the thread pool
+    inline T min(const vector<T, N> &x0, vector<T, N> &x1, thread_pool &pool)
+    {
+        const auto eval = [this, &pool](const std::vector<vector<T, N>> &x, std::vector<T> &values) {
+            pool.run(x.size(), [this, &x, &values](const size_t i) {
+                values[i] = _f(x[i]);
+            });
+        };
+
+        return search(x0, x1, eval);
+    }
+    // Returns best f(x) and sets x1, evaluates each generation with a user supplied batch function
+    inline T min(const vector<T, N> &x0, vector<T, N> &x1, const batch &eval)
+    {
+        return search(x0, x1, eval);
+    }
+    // Eigendecompositions of C in the last search
+    inline size_t get_decompositions() const
+    {
+        return _decompositions;
+    }
+    // Generations sampled in the last search
+    inline size_t get_generations() const
+    {
+        return _generations;
+    }
+    inline void seed(const unsigned seed)
+    {
+        _rgen.seed(seed);
+        _normal.reset();
+    }
+    inline void set_evaluations(const size_t evaluations)
+    {
+        _evaluations = evaluations;
+    }
+    // Zero selects the default population, otherwise at least two samples are needed for one parent
+    inline void set_population(const size_t lambda)
+    {
+        if (lambda == 1)
+        {
+            throw std::runtime_error("cmaes: population size must be at least 2");
+        }
+        _lambda = lambda;
+    }
+    inline void set_restarts(const size_t restarts)
+    {
+        _restarts = restarts;
+    }
+    inline void set_sigma(const T sigma)
+    {
+        _sigma = sigma;
+    }
+    inline void set_tolerance(const T tolerance)
+    {
+        _tolerance = tolerance;
+    }
+};
+} // namespace mml
+
+#endif
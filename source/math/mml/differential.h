@@ -0,0 +1,400 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __DIFFERENTIAL__
+#define __DIFFERENTIAL__
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <mml/equation.h>
+#include <mml/pool.h>
+#include <mml/vec.h>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace mml
+{
+
+// Differential evolution over box bounded vectors
+// Population is stored structure of arrays, element (d, i) is at [d * size + i]
+template <typename T, size_t N>
+class differential
+{
+  private:
+    static constexpr unsigned _rand_1 = 0;
+    static constexpr unsigned _best_2 = 1;
+    static constexpr unsigned _jade = 2;
+    function<T, N> _f;
+    vector<T, N> _lower;
+    vector<T, N> _upper;
+    size_t _size;
+    size_t _generations;
+    T _tolerance;
+    T _weight;
+    T _crossover;
+    unsigned _strategy;
+    std::mt19937 _rgen;
+
+    // Population, trial and jade archive buffers
+    std::vector<T> _pop;
+    std::vector<T> _trial;
+    std::vector<T> _archive;
+    std::vector<T> _fit;
+    std::vector<T> _trial_fit;
+    size_t _archive_size;
+
+    // Per member mutation parameters drawn each generation
+    std::vector<size_t> _r1;
+    std::vector<size_t> _r2;
+    std::vector<size_t> _r3;
+    std::vector<size_t> _r4;
+    std::vector<T> _f_i;
+    std::vector<T> _cr_i;
+    std::vector<T> _u;
+    std::vector<size_t> _jrand;
+
+    inline void initialize()
+    {
+        const size_t n = _size;
+        _pop.resize(N * n);
+        _trial.resize(N * n);
+        _archive.resize(N * n);
+        _fit.resize(n);
+        _trial_fit.resize(n);
+        _r1.resize(n);
+        _r2.resize(n);
+        _r3.resize(n);
+        _r4.resize(n);
+        _f_i.resize(n);
+        _cr_i.resize(n);
+        _u.resize(N * n);
+        _jrand.resize(n);
+        _archive_size = 0;
+
+        // Uniform random population inside the box
+        std::uniform_real_distribution<T> dist(0.0, 1.0);
+        for (size_t d = 0; d < N; d++)
+        {
+            const T lo = _lower[d];
+            const T range = _upper[d] - lo;
+            T *const p = &_pop[d * n];
+            for (size_t i = 0; i < n; i++)
+            {
+                p[i] = lo + range * dist(_rgen);
+            }
+        }
+    }
+    inline vector<T, N> member(const std::vector<T> &pop, const size_t i) const
+    {
+        // Gather column i into a vector
+        vector<T, N> out;
+        for (size_t d = 0; d < N; d++)
+        {
+            out[d] = pop[d * _size + i];
+        }
+
+        return out;
+    }
+    inline void evaluate(const std::vector<T> &pop, std::vector<T> &fit, const std::function<void(size_t, const std::function<void(const size_t)> &)> &run) const
+    {
+        run(_size, [this, &pop, &fit](const size_t i) {
+            fit[i] = _f(member(pop, i));
+        });
+    }
+    inline size_t draw(std::uniform_int_distribution<size_t> &dist, const size_t i, const size_t a = -1, const size_t b = -1, const size_t c = -1)
+    {
+        // Draw an index distinct from i and the previously drawn indices
+        size_t out = dist(_rgen);
+        while (out == i || out == a || out == b || out == c)
+        {
+            out = dist(_rgen);
+        }
+
+        return out;
+    }
+    inline void parameters(const T mu_f, const T mu_cr)
+    {
+        const size_t n = _size;
+        std::uniform_int_distribution<size_t> pick(0, n - 1);
+        std::uniform_int_distribution<size_t> pick_union(0, n + _archive_size - 1);
+        std::uniform_int_distribution<size_t> pick_dim(0, N - 1);
+        std::uniform_real_distribution<T> dist(0.0, 1.0);
+        std::cauchy_distribution<T> cauchy(mu_f, 0.1);
+        std::normal_distribution<T> normal(mu_cr, 0.1);
+
+        // Best 5% of the population for jade p-best selection
+        std::vector<size_t> top;
+        if (_strategy == _jade)
+        {
+            top.resize(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                top[i] = i;
+            }
+            const size_t p = std::max<size_t>(2, n / 20);
+            std::partial_sort(top.begin(), top.begin() + p, top.end(), [this](const size_t a, const size_t b) {
+                return _fit[a] < _fit[b];
+            });
+            top.resize(p);
+        }
+        std::uniform_int_distribution<size_t> pick_top(0, top.empty() ? 0 : top.size() - 1);
+
+        // Draw indices and control parameters serially so seeded runs are reproducible
+        for (size_t i = 0; i < n; i++)
+        {
+            if (_strategy == _jade)
+            {
+                // r1 is a p-best member, r3 may come from the archive
+                _r1[i] = top[pick_top(_rgen)];
+                _r2[i] = draw(pick, i, _r1[i]);
+                _r3[i] = draw(pick_union, i, _r1[i], _r2[i]);
+
+                // Sample F from cauchy and CR from normal distribution
+                T f = cauchy(_rgen);
+                while (f <= 0.0)
+                {
+                    f = cauchy(_rgen);
+                }
+                _f_i[i] = std::min(f, static_cast<T>(1.0));
+                _cr_i[i] = std::min(std::max(normal(_rgen), static_cast<T>(0.0)), static_cast<T>(1.0));
+            }
+            else
+            {
+                _r1[i] = draw(pick, i);
+                _r2[i] = draw(pick, i, _r1[i]);
+                _r3[i] = draw(pick, i, _r1[i], _r2[i]);
+                if (_strategy == _best_2)
+                {
+                    _r4[i] = draw(pick, i, _r1[i], _r2[i], _r3[i]);
+                }
+                _f_i[i] = _weight;
+                _cr_i[i] = _crossover;
+            }
+            _jrand[i] = pick_dim(_rgen);
+        }
+
+        // Crossover uniforms
+        for (size_t j = 0; j < N * n; j++)
+        {
+            _u[j] = dist(_rgen);
+        }
+    }
+    inline void mutate(const size_t best)
+    {
+        const size_t n = _size;
+        for (size_t d = 0; d < N; d++)
+        {
+            const T *const p = &_pop[d * n];
+            const T *const a = &_archive[d * n];
+            const T *const u = &_u[d * n];
+            T *const t = &_trial[d * n];
+            const T lo = _lower[d];
+            const T hi = _upper[d];
+
+            // Mutant vector for each member, strategy branch is hoisted out of the member loop
+            if (_strategy == _rand_1)
+            {
+                // DE/rand/1
+                for (size_t i = 0; i < n; i++)
+                {
+                    t[i] = p[_r1[i]] + _f_i[i] * (p[_r2[i]] - p[_r3[i]]);
+                }
+            }
+            else if (_strategy == _best_2)
+            {
+                // DE/best/2
+                const T pb = p[best];
+                for (size_t i = 0; i < n; i++)
+                {
+                    t[i] = pb + _f_i[i] * (p[_r1[i]] - p[_r2[i]] + p[_r3[i]] - p[_r4[i]]);
+                }
+            }
+            else
+            {
+                // DE/current-to-pbest/1 with archive
+                for (size_t i = 0; i < n; i++)
+                {
+                    const T x3 = (_r3[i] < n) ? p[_r3[i]] : a[_r3[i] - n];
+                    t[i] = p[i] + _f_i[i] * (p[_r1[i]] - p[i] + p[_r2[i]] - x3);
+                }
+            }
+
+            // Bounds and crossover
+            for (size_t i = 0; i < n; i++)
+            {
+                T v = t[i];
+
+                // Bounce back halfway between parent and violated bound
+                v = (v < lo) ? 0.5 * (lo + p[i]) : v;
+                v = (v > hi) ? 0.5 * (hi + p[i]) : v;
+
+                // Binomial crossover
+                t[i] = (u[i] < _cr_i[i] || d == _jrand[i]) ? v : p[i];
+            }
+        }
+    }
+    inline T search(vector<T, N> &x1, const std::function<void(size_t, const std::function<void(const size_t)> &)> &run)
+    {
+        const size_t n = _size;
+        if (n < 5)
+        {
+            throw std::runtime_error("differential: population size must be at least 5");
+        }
+
+        // Create and evaluate initial population
+        initialize();
+        evaluate(_pop, _fit, run);
+
+        // Jade adaptive parameter means
+        T mu_f = 0.5;
+        T mu_cr = 0.5;
+        const T c = 0.1;
+        std::uniform_int_distribution<size_t> pick(0, n - 1);
+
+        size_t best = std::min_element(_fit.begin(), _fit.end()) - _fit.begin();
+        for (size_t g = 0; g < _generations; g++)
+        {
+            // Stop if the population fitness has collapsed
+            const T worst = *std::max_element(_fit.begin(), _fit.end());
+            if (worst - _fit[best] < _tolerance)
+            {
+                break;
+            }
+
+            // Create and evaluate trial vectors
+            parameters(mu_f, mu_cr);
+            mutate(best);
+            evaluate(_trial, _trial_fit, run);
+
+            // Greedy selection
+            T sum_f = 0.0;
+            T sum_f2 = 0.0;
+            T sum_cr = 0.0;
+            size_t success = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                if (_trial_fit[i] <= _fit[i])
+                {
+                    if (_strategy == _jade && _trial_fit[i] < _fit[i])
+                    {
+                        // Archive the replaced parent
+                        const size_t slot = (_archive_size < n) ? _archive_size++ : pick(_rgen);
+                        for (size_t d = 0; d < N; d++)
+                        {
+                            _archive[d * n + slot] = _pop[d * n + i];
+                        }
+
+                        // Record successful parameters
+                        sum_f += _f_i[i];
+                        sum_f2 += _f_i[i] * _f_i[i];
+                        sum_cr += _cr_i[i];
+                        success++;
+                    }
+
+                    // Replace the parent
+                    for (size_t d = 0; d < N; d++)
+                    {
+                        _pop[d * n + i] = _trial[d * n + i];
+                    }
+                    _fit[i] = _trial_fit[i];
+                    if (_fit[i] < _fit[best])
+                    {
+                        best = i;
+                    }
+                }
+            }
+
+            // Adapt jade means, F uses the lehmer mean
+            if (success > 0)
+            {
+                mu_cr = (1.0 - c) * mu_cr + c * sum_cr / success;
+                mu_f = (1.0 - c) * mu_f + c * sum_f2 / sum_f;
+            }
+        }
+
+        // Return the best member
+        x1 = member(_pop, best);
+        return _fit[best];
+    }
+
+  public:
+    differential(const function<T, N> f, const vector<T, N> &lower, const vector<T, N> &upper)
+        : _f(f), _lower(lower), _upper(upper), _size(std::max<size_t>(20, 10 * N)), _generations(1000), _tolerance(1E-10),
+          _weight(0.5), _crossover(0.9), _strategy(_rand_1),
+          _rgen(std::chrono::high_resolution_clock::now().time_since_epoch().count()), _archive_size(0) {}
+
+    // Returns best f(x) and sets x1, evaluates serially
+    inline T min(vector<T, N> &x1)
+    {
+        const auto run = [](const size_t size, const std::function<void(const size_t)> &work) {
+            for (size_t i = 0; i < size; i++)
+            {
+                work(i);
+            }
+        };
+
+        return search(x1, run);
+    }
+    // Returns best f(x) and sets x1, evaluates each generation in the thread pool
+    inline T min(vector<T, N> &x1, thread_pool &pool)
+    {
+        const auto run = [&pool](const size_t size, const std::function<void(const size_t)> &work) {
+            pool.run(size, work);
+        };
+
+        return search(x1, run);
+    }
+    inline void seed(const unsigned seed)
+    {
+        _rgen.seed(seed);
+    }
+    inline void set_best_2()
+    {
+        _strategy = _best_2;
+    }
+    inline void set_crossover(const T crossover)
+    {
+        _crossover = crossover;
+    }
+    inline void set_generations(const size_t generations)
+    {
+        _generations = generations;
+    }
+    inline void set_jade()
+    {
+        _strategy = _jade;
+    }
+    inline void set_rand_1()
+    {
+        _strategy = _rand_1;
+    }
+    inline void set_size(const size_t size)
+    {
+        _size = size;
+    }
+    inline void set_tolerance(const T tolerance)
+    {
+        _tolerance = tolerance;
+    }
+    inline void set_weight(const T weight)
+    {
+        _weight = weight;
+    }
+};
+} // namespace mml
+
+#endif
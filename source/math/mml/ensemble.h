@@ -0,0 +1,568 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __ENSEMBLE__
+#define __ENSEMBLE__
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <mml/ode.h>
+#include <mml/pool.h>
+#include <mml/vec.h>
+#include <stdexcept>
+#include <vector>
+
+namespace mml
+{
+
+// Right hand side of count ensemble members at once, structure of arrays
+// Member i has time t[i] and state y[0][i] ... y[N - 1][i], derivatives are written to dy[0][i] ... dy[N - 1][i]
+template <typename T, size_t N>
+using ensemble_function = std::function<void(const T *t, const T *const *y, T *const *dy, const size_t count)>;
+
+// Explicit runge-kutta integration of many trajectories of y' = f(t, y) in lockstep
+// Trajectories are stored structure of arrays, element (d, i) is at [d * size + i]
+// Each member has its own time and step size, so stage arithmetic vectorizes across members
+// The ensemble is split into chunks which are integrated independently, optionally in a thread pool
+template <typename T, size_t N>
+class ensemble
+{
+  private:
+    static constexpr unsigned _dormand_prince = 0;
+    static constexpr unsigned _tsitouras = 1;
+    static constexpr unsigned _rk4 = 2;
+    static constexpr size_t _stages = 7;
+    ensemble_function<T, N> _f;
+    size_t _size;
+    std::vector<T> _y;
+    size_t _chunk;
+    size_t _max_steps;
+    T _rtol;
+    T _atol;
+    T _step;
+    unsigned _method;
+    size_t _evaluations;
+    size_t _steps;
+
+    // Butcher tableau of the active method
+    size_t _s;
+    size_t _order;
+    bool _fsal;
+    T _a[_stages][_stages];
+    T _b[_stages];
+    T _c[_stages];
+    T _e[_stages];
+
+    inline void tableau()
+    {
+        // Clear tableau
+        for (size_t i = 0; i < _stages; i++)
+        {
+            for (size_t j = 0; j < _stages; j++)
+            {
+                _a[i][j] = 0.0;
+            }
+            _b[i] = 0.0;
+            _c[i] = 0.0;
+            _e[i] = 0.0;
+        }
+
+        if (_method == _rk4)
+        {
+            // Classical fourth order runge-kutta, fixed step only
+            _s = 4;
+            _order = 4;
+            _fsal = false;
+            _a[1][0] = 0.5;
+            _a[2][1] = 0.5;
+            _a[3][2] = 1.0;
+            _b[0] = 1.0 / 6.0;
+            _b[1] = 1.0 / 3.0;
+            _b[2] = 1.0 / 3.0;
+            _b[3] = 1.0 / 6.0;
+            _c[1] = 0.5;
+            _c[2] = 0.5;
+            _c[3] = 1.0;
+        }
+        else if (_method == _tsitouras)
+        {
+            // Tsitouras 5(4), Computers and Mathematics with Applications 62 (2011)
+            _s = 7;
+            _order = 5;
+            _fsal = true;
+            _a[1][0] = 0.161;
+            _a[2][0] = -0.008480655492356989;
+            _a[2][1] = 0.335480655492357;
+            _a[3][0] = 2.897153057105493;
+            _a[3][1] = -6.359448489975075;
+            _a[3][2] = 4.3622954328695815;
+            _a[4][0] = 5.325864828439257;
+            _a[4][1] = -11.748883564062828;
+            _a[4][2] = 7.4955393428898365;
+            _a[4][3] = -0.09249506636175525;
+            _a[5][0] = 5.86145544294642;
+            _a[5][1] = -12.92096931784711;
+            _a[5][2] = 8.159367898576159;
+            _a[5][3] = -0.071584973281401;
+            _a[5][4] = -0.028269050394068383;
+            _a[6][0] = 0.09646076681806523;
+            _a[6][1] = 0.01;
+            _a[6][2] = 0.4798896504144996;
+            _a[6][3] = 1.379008574103742;
+            _a[6][4] = -3.290069515436081;
+            _a[6][5] = 2.324710524099774;
+            _c[1] = 0.161;
+            _c[2] = 0.327;
+            _c[3] = 0.9;
+            _c[4] = 0.9800255409045097;
+            _c[5] = 1.0;
+            _c[6] = 1.0;
+            _e[0] = -0.00178001105222577714;
+            _e[1] = -0.0008164344596567469;
+            _e[2] = 0.007880878010261995;
+            _e[3] = -0.1447110071732629;
+            _e[4] = 0.5823571654525552;
+            _e[5] = -0.45808210592918697;
+            _e[6] = 1.0 / 66.0;
+        }
+        else
+        {
+            // Dormand-Prince 5(4)
+            _s = 7;
+            _order = 5;
+            _fsal = true;
+            _a[1][0] = 1.0 / 5.0;
+            _a[2][0] = 3.0 / 40.0;
+            _a[2][1] = 9.0 / 40.0;
+            _a[3][0] = 44.0 / 45.0;
+            _a[3][1] = -56.0 / 15.0;
+            _a[3][2] = 32.0 / 9.0;
+            _a[4][0] = 19372.0 / 6561.0;
+            _a[4][1] = -25360.0 / 2187.0;
+            _a[4][2] = 64448.0 / 6561.0;
+            _a[4][3] = -212.0 / 729.0;
+            _a[5][0] = 9017.0 / 3168.0;
+            _a[5][1] = -355.0 / 33.0;
+            _a[5][2] = 46732.0 / 5247.0;
+            _a[5][3] = 49.0 / 176.0;
+            _a[5][4] = -5103.0 / 18656.0;
+            _a[6][0] = 35.0 / 384.0;
+            _a[6][2] = 500.0 / 1113.0;
+            _a[6][3] = 125.0 / 192.0;
+            _a[6][4] = -2187.0 / 6784.0;
+            _a[6][5] = 11.0 / 84.0;
+            _c[1] = 1.0 / 5.0;
+            _c[2] = 3.0 / 10.0;
+            _c[3] = 4.0 / 5.0;
+            _c[4] = 8.0 / 9.0;
+            _c[5] = 1.0;
+            _c[6] = 1.0;
+            _e[0] = 71.0 / 57600.0;
+            _e[2] = -71.0 / 16695.0;
+            _e[3] = 71.0 / 1920.0;
+            _e[4] = -17253.0 / 339200.0;
+            _e[5] = 22.0 / 525.0;
+            _e[6] = -1.0 / 40.0;
+        }
+
+        // First same as last methods use the last stage row as weights
+        if (_fsal)
+        {
+            for (size_t j = 0; j < _stages; j++)
+            {
+                _b[j] = _a[_s - 1][j];
+            }
+        }
+    }
+    // Integrates members [begin, begin + count) from t0 to t1, adds accepted steps and evaluations
+    inline void integrate_chunk(const size_t begin, const size_t count, const T t0, const T t1, size_t &steps, size_t &evaluations)
+    {
+        const size_t n = count;
+
+        // Chunk local buffers, stages are k[s * N * n + d * n + i]
+        std::vector<T> y(N * n);
+        std::vector<T> yt(N * n);
+        std::vector<T> k(_stages * N * n);
+        std::vector<T> t(n, t0);
+        std::vector<T> tt(n);
+        std::vector<T> h(n);
+        std::vector<T> err(n);
+        std::vector<T> ok(n);
+        std::vector<T> scratch(n);
+        const T *yp[N];
+        T *ytp[N];
+        T *kp[_stages][N];
+        for (size_t d = 0; d < N; d++)
+        {
+            yp[d] = &y[d * n];
+            ytp[d] = &yt[d * n];
+            for (size_t s = 0; s < _stages; s++)
+            {
+                kp[s][d] = &k[s * N * n + d * n];
+            }
+        }
+
+        // Gather chunk from the ensemble
+        for (size_t d = 0; d < N; d++)
+        {
+            std::copy(&_y[d * _size + begin], &_y[d * _size + begin] + n, &y[d * n]);
+        }
+
+        // First stage at the initial point
+        _f(&t[0], yp, kp[0], n);
+        evaluations += n;
+
+        // Initial step size
+        const bool fixed = _step > 0.0;
+        if (fixed)
+        {
+            std::fill(h.begin(), h.end(), _step);
+        }
+        else
+        {
+            // Ratio of solution to derivative magnitudes per member
+            std::vector<T> d0(n, 0.0);
+            std::fill(err.begin(), err.end(), 0.0);
+            for (size_t d = 0; d < N; d++)
+            {
+                const T *const yd = yp[d];
+                const T *const kd = kp[0][d];
+                T *const a = &d0[0];
+                T *const b = &err[0];
+                for (size_t i = 0; i < n; i++)
+                {
+                    const T scale = 1.0 / (_atol + _rtol * std::abs(yd[i]));
+                    a[i] += (yd[i] * scale) * (yd[i] * scale);
+                    b[i] += (kd[i] * scale) * (kd[i] * scale);
+                }
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                const T ny = std::sqrt(d0[i] / N);
+                const T nf = std::sqrt(err[i] / N);
+                h[i] = (ny < 1E-5 || nf < 1E-5) ? 1E-6 : 0.01 * ny / nf;
+            }
+        }
+
+        // Step until all members reach t1
+        for (size_t step = 0; step < _max_steps; step++)
+        {
+            // Clip steps to the end of the interval, finished members take zero steps
+            bool running = false;
+            for (size_t i = 0; i < n; i++)
+            {
+                const T remain = t1 - t[i];
+                h[i] = std::min(h[i], remain);
+                running = running || remain > 0.0;
+            }
+            if (!running)
+            {
+                // Scatter chunk back to the ensemble, chunks never overlap
+                for (size_t d = 0; d < N; d++)
+                {
+                    std::copy(&y[d * n], &y[d * n] + n, &_y[d * _size + begin]);
+                }
+                return;
+            }
+
+            // Stages 1 to s - 1
+            for (size_t s = 1; s < _s; s++)
+            {
+                for (size_t d = 0; d < N; d++)
+                {
+                    // Stage state y + h * sum(a * k)
+                    T *const out = ytp[d];
+                    std::fill(out, out + n, 0.0);
+                    for (size_t j = 0; j < s; j++)
+                    {
+                        const T a = _a[s][j];
+                        const T *const kj = kp[j][d];
+                        for (size_t i = 0; i < n; i++)
+                        {
+                            out[i] += a * kj[i];
+                        }
+                    }
+                    const T *const yd = yp[d];
+                    const T *const hp = &h[0];
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        out[i] = yd[i] + hp[i] * out[i];
+                    }
+                }
+                const T c = _c[s];
+                for (size_t i = 0; i < n; i++)
+                {
+                    tt[i] = t[i] + c * h[i];
+                }
+                _f(&tt[0], ytp, kp[s], n);
+                evaluations += n;
+            }
+
+            // New solution, the last stage state for first same as last methods
+            if (!_fsal)
+            {
+                for (size_t d = 0; d < N; d++)
+                {
+                    T *const out = ytp[d];
+                    std::fill(out, out + n, 0.0);
+                    for (size_t j = 0; j < _s; j++)
+                    {
+                        const T b = _b[j];
+                        const T *const kj = kp[j][d];
+                        for (size_t i = 0; i < n; i++)
+                        {
+                            out[i] += b * kj[i];
+                        }
+                    }
+                    const T *const yd = yp[d];
+                    const T *const hp = &h[0];
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        out[i] = yd[i] + hp[i] * out[i];
+                    }
+                }
+            }
+
+            // Local error estimate per member
+            if (fixed)
+            {
+                std::fill(ok.begin(), ok.end(), 1.0);
+            }
+            else
+            {
+                std::fill(err.begin(), err.end(), 0.0);
+                for (size_t d = 0; d < N; d++)
+                {
+                    // Weighted stage sum of the error estimate
+                    T *const e = &scratch[0];
+                    std::fill(e, e + n, 0.0);
+                    for (size_t j = 0; j < _s; j++)
+                    {
+                        const T ej = _e[j];
+                        const T *const kj = kp[j][d];
+                        for (size_t i = 0; i < n; i++)
+                        {
+                            e[i] += ej * kj[i];
+                        }
+                    }
+                    const T *const yd = yp[d];
+                    const T *const yn = ytp[d];
+                    const T *const hp = &h[0];
+                    T *const ep = &err[0];
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        const T x = hp[i] * e[i] / (_atol + _rtol * std::max(std::abs(yd[i]), std::abs(yn[i])));
+                        ep[i] += x * x;
+                    }
+                }
+                for (size_t i = 0; i < n; i++)
+                {
+                    err[i] = std::sqrt(err[i] / N);
+                    ok[i] = (err[i] <= 1.0) ? 1.0 : 0.0;
+                }
+            }
+
+            // Accept members with small error, masked so the loops stay branch free
+            for (size_t d = 0; d < N; d++)
+            {
+                T *const yd = &y[d * n];
+                const T *const yn = ytp[d];
+                T *const k0 = kp[0][d];
+                const T *const kl = kp[_s - 1][d];
+                const T *const m = &ok[0];
+                for (size_t i = 0; i < n; i++)
+                {
+                    yd[i] = (m[i] > 0.0) ? yn[i] : yd[i];
+                }
+                if (_fsal)
+                {
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        k0[i] = (m[i] > 0.0) ? kl[i] : k0[i];
+                    }
+                }
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                steps += (ok[i] > 0.0 && h[i] > 0.0) ? 1 : 0;
+                t[i] = (ok[i] > 0.0) ? ((h[i] == t1 - t[i]) ? t1 : t[i] + h[i]) : t[i];
+            }
+
+            // First stage of the next step
+            if (!_fsal)
+            {
+                _f(&t[0], yp, kp[0], n);
+                evaluations += n;
+            }
+
+            // Next step size
+            if (!fixed)
+            {
+                const T exponent = -1.0 / _order;
+                for (size_t i = 0; i < n; i++)
+                {
+                    const T factor = (err[i] > 0.0) ? 0.9 * std::pow(err[i], exponent) : 5.0;
+                    h[i] *= std::min(static_cast<T>(5.0), std::max(static_cast<T>(0.2), factor));
+                }
+            }
+            else
+            {
+                std::fill(h.begin(), h.end(), _step);
+            }
+        }
+
+        throw std::runtime_error("ensemble: maximum number of steps exceeded");
+    }
+    inline void integrate_all(const T t0, const T t1, const std::function<void(size_t, const std::function<void(const size_t)> &)> &run)
+    {
+        if (t1 < t0)
+        {
+            throw std::runtime_error("ensemble: can't integrate backward, t1 is before t0");
+        }
+        else if (_method == _rk4 && !(_step > 0.0))
+        {
+            throw std::runtime_error("ensemble: rk4 requires a fixed step size");
+        }
+
+        // Chunk statistics are summed after the run so threads do not share counters
+        const size_t chunks = (_size + _chunk - 1) / _chunk;
+        std::vector<size_t> steps(chunks, 0);
+        std::vector<size_t> evaluations(chunks, 0);
+        run(chunks, [this, t0, t1, &steps, &evaluations](const size_t c) {
+            const size_t begin = c * _chunk;
+            const size_t count = std::min(_chunk, _size - begin);
+            integrate_chunk(begin, count, t0, t1, steps[c], evaluations[c]);
+        });
+        for (size_t c = 0; c < chunks; c++)
+        {
+            _steps += steps[c];
+            _evaluations += evaluations[c];
+        }
+    }
+
+  public:
+    ensemble(const ensemble_function<T, N> &f, const size_t size)
+        : _f(f), _size(size), _y(N * size), _chunk(256), _max_steps(100000), _rtol(1E-6), _atol(1E-9), _step(0.0),
+          _method(_dormand_prince), _evaluations(0), _steps(0)
+    {
+        tableau();
+    }
+    // Wraps a single trajectory right hand side, members are gathered and evaluated one at a time
+    ensemble(const ode_function<T, N> &f, const size_t size)
+        : ensemble([f](const T *t, const T *const *y, T *const *dy, const size_t count) {
+              vector<T, N> x;
+              for (size_t i = 0; i < count; i++)
+              {
+                  for (size_t d = 0; d < N; d++)
+                  {
+                      x[d] = y[d][i];
+                  }
+                  const vector<T, N> fx = f(t[i], x);
+                  for (size_t d = 0; d < N; d++)
+                  {
+                      dy[d][i] = fx[d];
+                  }
+              }
+          },
+                   size) {}
+    inline vector<T, N> get(const size_t i) const
+    {
+        vector<T, N> out;
+        for (size_t d = 0; d < N; d++)
+        {
+            out[d] = _y[d * _size + i];
+        }
+
+        return out;
+    }
+    // Total number of right hand side evaluations over all members
+    inline size_t get_evaluations() const
+    {
+        return _evaluations;
+    }
+    inline size_t get_size() const
+    {
+        return _size;
+    }
+    // Total number of accepted steps over all members
+    inline size_t get_steps() const
+    {
+        return _steps;
+    }
+    // Advances all members from t0 to t1, throws if t1 is before t0
+    inline void integrate(const T t0, const T t1)
+    {
+        const auto run = [](const size_t size, const std::function<void(const size_t)> &work) {
+            for (size_t i = 0; i < size; i++)
+            {
+                work(i);
+            }
+        };
+
+        integrate_all(t0, t1, run);
+    }
+    // Advances all members from t0 to t1, chunks are integrated in the thread pool
+    inline void integrate(const T t0, const T t1, thread_pool &pool)
+    {
+        const auto run = [&pool](const size_t size, const std::function<void(const size_t)> &work) {
+            pool.run(size, work);
+        };
+
+        integrate_all(t0, t1, run);
+    }
+    inline void set(const size_t i, const vector<T, N> &y)
+    {
+        for (size_t d = 0; d < N; d++)
+        {
+            _y[d * _size + i] = y[d];
+        }
+    }
+    inline void set_chunk(const size_t chunk)
+    {
+        _chunk = std::max(chunk, static_cast<size_t>(1));
+    }
+    inline void set_dormand_prince()
+    {
+        _method = _dormand_prince;
+        tableau();
+    }
+    inline void set_max_steps(const size_t steps)
+    {
+        _max_steps = steps;
+    }
+    inline void set_rk4()
+    {
+        _method = _rk4;
+        tableau();
+    }
+    // A positive step disables error control and integrates with fixed steps, zero restores adaptive steps
+    inline void set_step(const T step)
+    {
+        _step = step;
+    }
+    inline void set_tolerance(const T rtol, const T atol)
+    {
+        _rtol = rtol;
+        _atol = atol;
+    }
+    inline void set_tsitouras()
+    {
+        _method = _tsitouras;
+        tableau();
+    }
+};
+} // namespace mml
+
+#endif
@@ -15,8 +15,16 @@ limitations under the License.
 #ifndef __EQUATION__
 #define __EQUATION__
 
+#include <algorithm>
+#include <functional>
+#include <limits>
 #include <mml/mat.h>
+#include <mml/mult.h>
+#include <mml/pool.h>
 #include <mml/vec.h>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 namespace mml
 {
@@ -31,6 +39,673 @@ class equation
   private:
     function<T, N> _f;
 
+    inline T bfgs(const vector<T, N> &x0, vector<T, N> &x1, matrix<T, N, N> &hinv, const size_t iterations, const T tolerance, const bool scale) const
+    {
+        // Start searching for minimum of equation
+        x1 = x0;
+
+        // Backtracking parameters
+        const T alpha = 1E-4;
+        const T B = 0.5;
+        const T min_step = 1E-10;
+
+        // Evaluate the function and gradient at the starting point
+        T fx = (*this)(x1);
+        vector<T, N> grad = numeric<T, N>::gradient(*this, x1, tolerance);
+
+        // Calculate the convergence criteria
+        T convergence = grad.square_magnitude();
+
+        // Search for up to _max_iterations
+        for (size_t i = 0; i < iterations; i++)
+        {
+            // Determine if we have converged
+            if (convergence < tolerance)
+            {
+                return convergence;
+            }
+
+            // Calculate the quasi-newton search direction, dx = -H^-1 * grad(x)
+            vector<T, N> dx = multiply(hinv, grad) * -1.0;
+            T slope = grad.dot(dx);
+
+            // If approximation lost positive definiteness, restart with steepest descent
+            if (slope >= 0.0)
+            {
+                hinv = matrix<T, N, N>();
+                dx = grad * -1.0;
+                slope = -convergence;
+            }
+
+            // Perform backtracking, f(x + t*dx) > f(x) + alpha*t*grad(x)*dx
+            T t = 1.0;
+            T fx1 = (*this)(x1 + dx * t);
+            while (fx1 > fx + alpha * t * slope && t > min_step)
+            {
+                t *= B;
+                fx1 = (*this)(x1 + dx * t);
+            }
+
+            // Step to next iteration
+            const vector<T, N> s = dx * t;
+            x1 += s;
+
+            // Calculate the change in gradient
+            const vector<T, N> grad1 = numeric<T, N>::gradient(*this, x1, tolerance);
+            const vector<T, N> y = grad1 - grad;
+
+            // Only update if curvature condition holds, otherwise H^-1 becomes indefinite
+            const T sy = s.dot(y);
+            if (sy > 0.0)
+            {
+                // Scale the initial identity matrix to the curvature on the first step
+                if (scale && i == 0)
+                {
+                    hinv = matrix<T, N, N>();
+                    const T gamma = sy / y.square_magnitude();
+                    for (size_t j = 0; j < N; j++)
+                    {
+                        hinv.get(j, j) = gamma;
+                    }
+                }
+
+                // Rank-2 update, H^-1 = (I - p*s*y') * H^-1 * (I - p*y*s') + p*s*s'
+                const vector<T, N> hy = multiply(hinv, y);
+                const T p = 1.0 / sy;
+                const T ss = p + p * p * y.dot(hy);
+                for (size_t j = 0; j < N; j++)
+                {
+                    for (size_t k = 0; k < N; k++)
+                    {
+                        hinv.get(j, k) += ss * s[j] * s[k] - p * (hy[j] * s[k] + s[j] * hy[k]);
+                    }
+                }
+            }
+
+            // Store the state for the next iteration
+            grad = grad1;
+            fx = fx1;
+
+            // Calculate the convergence criteria
+            convergence = grad.square_magnitude();
+        }
+
+        // Return the sum square of the function gradient, should be close to zero at solution
+        return convergence;
+    }
+    inline T conjugate(const std::function<T(const vector<T, N> &, const vector<T, N> &, const vector<T, N> &)> &beta,
+                       const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance) const
+    {
+        // Start searching for minimum of equation
+        x1 = x0;
+
+        // Evaluate the function and gradient at the starting point
+        T fx = (*this)(x1);
+        vector<T, N> grad = numeric<T, N>::gradient(*this, x1, tolerance);
+
+        // Calculate the convergence criteria
+        T convergence = grad.square_magnitude();
+
+        // First direction is steepest descent
+        vector<T, N> dx = grad * -1.0;
+        T slope = -convergence;
+        T t = 1.0;
+
+        // Search for up to _max_iterations
+        for (size_t i = 0; i < iterations; i++)
+        {
+            // Determine if we have converged
+            if (convergence < tolerance)
+            {
+                return convergence;
+            }
+
+            // Search along the conjugate direction
+            T fx1 = fx;
+            t = line_search(x1, dx, fx, slope, t, fx1);
+
+            // Step to next iteration
+            x1 += dx * t;
+
+            // Calculate the new gradient
+            const vector<T, N> grad1 = numeric<T, N>::gradient(*this, x1, tolerance);
+
+            // Restart with steepest descent every N iterations, otherwise d = -grad(x) + beta*d
+            const T b = ((i + 1) % N == 0) ? 0.0 : beta(grad1, grad, dx);
+            const vector<T, N> dx1 = grad1 * -1.0 + dx * b;
+            const T slope1 = grad1.dot(dx1);
+
+            // Initial step of next search keeps the same first order change, t*g'*d
+            t = t * slope / slope1;
+
+            // Restart if the new direction is not a descent direction
+            if (slope1 >= 0.0)
+            {
+                dx = grad1 * -1.0;
+                slope = -grad1.square_magnitude();
+                t = 1.0;
+            }
+            else
+            {
+                dx = dx1;
+                slope = slope1;
+            }
+
+            // Store the state for the next iteration
+            grad = grad1;
+            fx = fx1;
+
+            // Calculate the convergence criteria
+            convergence = grad.square_magnitude();
+        }
+
+        // Return the sum square of the function gradient, should be close to zero at solution
+        return convergence;
+    }
+    inline T line_search(const vector<T, N> &x, const vector<T, N> &dx, const T fx, const T slope, const T t0, T &fx1) const
+    {
+        // Backtracking parameters
+        const T alpha = 1E-4;
+        const T min_step = 1E-10;
+
+        // Evaluate the trial step
+        T t = t0;
+        T ft = (*this)(x + dx * t);
+        while (t > min_step)
+        {
+            // Fit quadratic q(t) = f(x) + slope*t + c*t^2 through f(x + t*dx)
+            const T c = (ft - fx - slope * t) / (t * t);
+
+            // If the quadratic has a minimum, try stepping to it; exact for quadratic functions
+            if (c > 0.0)
+            {
+                const T tq = -slope / (2.0 * c);
+                const T fq = (*this)(x + dx * tq);
+                if (fq <= ft && fq <= fx + alpha * tq * slope)
+                {
+                    fx1 = fq;
+                    return tq;
+                }
+            }
+
+            // Accept the trial step if it sufficiently decreases f(x)
+            if (ft <= fx + alpha * t * slope)
+            {
+                fx1 = ft;
+                return t;
+            }
+
+            // Backtrack toward the quadratic minimum, safeguarded to [0.1*t, 0.5*t]
+            const T tq = (c > 0.0) ? -slope / (2.0 * c) : 0.5 * t;
+            t = std::max(0.1 * t, std::min(tq, 0.5 * t));
+            ft = (*this)(x + dx * t);
+        }
+
+        // Return the last step
+        fx1 = ft;
+        return t;
+    }
+
+    inline static T boundary(const vector<T, N> &z, const vector<T, N> &d, const T delta)
+    {
+        // Solve |z + tau*d| = delta for positive tau
+        const T dd = d.square_magnitude();
+        const T zd = z.dot(d);
+        const T zz = z.square_magnitude();
+
+        return (-zd + std::sqrt(zd * zd + dd * (delta * delta - zz))) / dd;
+    }
+    inline vector<T, N> steihaug(const vector<T, N> &x, const vector<T, N> &grad, const T delta, const T tolerance, T &pred) const
+    {
+        // Solve min m(p) = grad*p + 0.5*p'*H*p, |p| <= delta with truncated conjugate gradient
+        vector<T, N> z;
+        vector<T, N> hz;
+        vector<T, N> r = grad;
+        vector<T, N> d = grad * -1.0;
+        T rr = r.square_magnitude();
+
+        // Relative residual tolerance for superlinear convergence
+        const T eps = std::min(static_cast<T>(0.5), std::sqrt(std::sqrt(rr))) * std::sqrt(rr);
+
+        // At most N conjugate directions exist
+        for (size_t j = 0; j < N; j++)
+        {
+            // Calculate hessian along search direction
+            const vector<T, N> hd = numeric<T, N>::hessian_vector(*this, x, grad, d, tolerance);
+            const T dhd = d.dot(hd);
+
+            // If negative curvature, follow direction to the trust region boundary
+            if (dhd <= 0.0)
+            {
+                const T tau = boundary(z, d, delta);
+                z += d * tau;
+                hz += hd * tau;
+                break;
+            }
+
+            // Step along conjugate direction
+            const T alpha = rr / dhd;
+            const vector<T, N> z1 = z + d * alpha;
+
+            // If step leaves the trust region, stop at the boundary
+            if (z1.square_magnitude() >= delta * delta)
+            {
+                const T tau = boundary(z, d, delta);
+                z += d * tau;
+                hz += hd * tau;
+                break;
+            }
+
+            // Update the residual
+            z = z1;
+            hz += hd * alpha;
+            r += hd * alpha;
+
+            // Determine if we have converged
+            const T rr1 = r.square_magnitude();
+            if (rr1 < eps * eps)
+            {
+                break;
+            }
+
+            // Calculate next conjugate direction
+            d = r * -1.0 + d * (rr1 / rr);
+            rr = rr1;
+        }
+
+        // Predicted reduction of the quadratic model, -m(p)
+        pred = -(grad.dot(z) + 0.5 * z.dot(hz));
+
+        return z;
+    }
+    inline vector<T, N> dogleg(const vector<T, N> &x, const vector<T, N> &grad, const T delta, const T tolerance, const bool update,
+                               matrix<T, N, N> &hess, vector<T, N> &pb, bool &newton, T &pred) const
+    {
+        // Calculate the symmetric part of the hessian matrix and the newton step, both are kept while x does not change
+        if (update)
+        {
+            const matrix<T, N, N> h = numeric<T, N>::hessian(*this, x, tolerance);
+            for (size_t i = 0; i < N; i++)
+            {
+                for (size_t j = 0; j < N; j++)
+                {
+                    hess.get(i, j) = 0.5 * (h.get(i, j) + h.get(j, i));
+                }
+            }
+
+            // Try the full newton step, the hessian may be singular
+            try
+            {
+                pb = hess.ludecomp(grad) * -1.0;
+                newton = grad.dot(pb) < 0.0;
+            }
+            catch (std::exception &ex)
+            {
+                newton = false;
+            }
+        }
+
+        // Calculate the cauchy point along steepest descent
+        const vector<T, N> hg = multiply(hess, grad);
+        const T gg = grad.square_magnitude();
+        const T ghg = grad.dot(hg);
+        const T g_norm = std::sqrt(gg);
+
+        vector<T, N> p;
+        if (ghg <= 0.0 || (gg / ghg) * g_norm >= delta)
+        {
+            // Negative curvature or cauchy point outside region, step to the boundary
+            p = grad * (-delta / g_norm);
+        }
+        else
+        {
+            // Cauchy point inside the trust region
+            const vector<T, N> pu = grad * (-gg / ghg);
+            if (!newton)
+            {
+                // Newton step is not a descent direction, use the cauchy point
+                p = pu;
+            }
+            else if (pb.square_magnitude() <= delta * delta)
+            {
+                // Full newton step is inside the trust region
+                p = pb;
+            }
+            else
+            {
+                // Step along the dogleg segment from cauchy point to newton point
+                const T tau = boundary(pu, pb - pu, delta);
+                p = pu + (pb - pu) * tau;
+            }
+        }
+
+        // Predicted reduction of the quadratic model, -m(p)
+        pred = -(grad.dot(p) + 0.5 * p.dot(multiply(hess, p)));
+
+        return p;
+    }
+    inline T trust_region(const std::function<vector<T, N>(const vector<T, N> &, const vector<T, N> &, const T, const bool, T &)> &subproblem,
+                          const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance) const
+    {
+        // Trust region parameters
+        const T eta = 1E-4;
+        const T max_delta = 1E6;
+        T delta = 1.0;
+
+        // Start searching for minimum of equation
+        x1 = x0;
+        T fx = (*this)(x1);
+
+        // Calculate the convergence criteria
+        T convergence = 0.0;
+
+        // The gradient only changes when a step is accepted
+        vector<T, N> grad;
+        bool moved = true;
+
+        // Search for up to _max_iterations
+        for (size_t i = 0; i < iterations; i++)
+        {
+            // Evaluate the gradient at x1
+            if (moved)
+            {
+                grad = numeric<T, N>::gradient(*this, x1, tolerance);
+            }
+
+            // Calculate the convergence criteria
+            convergence = grad.square_magnitude();
+
+            // Determine if we have converged
+            if (convergence < tolerance)
+            {
+                return convergence;
+            }
+
+            // Solve the trust region subproblem, the subproblem may reuse its model while x1 is unchanged
+            T pred = 0.0;
+            const vector<T, N> p = subproblem(x1, grad, delta, moved, pred);
+
+            // Compare actual reduction to predicted reduction
+            const vector<T, N> x2 = x1 + p;
+            const T fx2 = (*this)(x2);
+            const T rho = (pred > 0.0) ? (fx - fx2) / pred : -1.0;
+
+            // Shrink the region if the model is poor, grow if model is good at the boundary
+            const T p_norm = std::sqrt(p.square_magnitude());
+            if (rho < 0.25)
+            {
+                delta = 0.25 * p_norm;
+            }
+            else if (rho > 0.75 && p_norm >= 0.99 * delta)
+            {
+                delta = std::min(2.0 * delta, max_delta);
+            }
+
+            // Only accept steps that decrease the function
+            moved = rho > eta;
+            if (moved)
+            {
+                x1 = x2;
+                fx = fx2;
+            }
+        }
+
+        // Return the sum square of the function gradient, should be close to zero at solution
+        return convergence;
+    }
+
+    inline static vector<T, N> project(const vector<T, N> &x, const vector<T, N> &lower, const vector<T, N> &upper)
+    {
+        vector<T, N> out;
+
+        // Clamp x into the box [lower, upper]
+        for (size_t i = 0; i < N; i++)
+        {
+            out[i] = std::max(lower[i], std::min(x[i], upper[i]));
+        }
+
+        return out;
+    }
+    inline static T projected_gradient(const vector<T, N> &x, const vector<T, N> &grad, const vector<T, N> &lower, const vector<T, N> &upper)
+    {
+        // Square magnitude of P(x - grad) - x, zero at a constrained minimum
+        return (project(x - grad, lower, upper) - x).square_magnitude();
+    }
+    template <size_t H>
+    inline static vector<T, 2 * H> box_row(const std::vector<vector<T, N>> &s, const std::vector<vector<T, N>> &y, const T theta, const size_t i)
+    {
+        // Row i of W = [Y, theta*S], unused history columns are zero
+        vector<T, 2 * H> w;
+        const size_t k = s.size();
+        for (size_t j = 0; j < k; j++)
+        {
+            w[j] = y[j][i];
+            w[H + j] = theta * s[j][i];
+        }
+
+        return w;
+    }
+    template <size_t H>
+    inline static matrix<T, 2 * H, 2 * H> box_middle(const std::vector<vector<T, N>> &s, const std::vector<vector<T, N>> &y, const T theta)
+    {
+        // Compact form of L-BFGS matrix, B = theta*I - W*M*W'
+        // M^-1 = [-D, L'; L, theta*S'*S], D = diag(s_i'*y_i), L_ij = s_i'*y_j for i > j
+        // Unused history is padded with identity so it does not couple with W
+        matrix<T, 2 * H, 2 * H> minv;
+        const size_t k = s.size();
+        for (size_t i = 0; i < k; i++)
+        {
+            for (size_t j = 0; j < k; j++)
+            {
+                const T l = (i > j) ? s[i].dot(y[j]) : 0.0;
+                minv.get(i, j) = (i == j) ? -s[i].dot(y[i]) : 0.0;
+                minv.get(H + i, H + j) = theta * s[i].dot(s[j]);
+                minv.get(H + i, j) = l;
+                minv.get(j, H + i) = l;
+            }
+        }
+
+        // Invert the middle matrix column by column
+        matrix<T, 2 * H, 2 * H> m;
+        for (size_t j = 0; j < 2 * H; j++)
+        {
+            vector<T, 2 * H> e;
+            e[j] = 1.0;
+            const vector<T, 2 * H> col = minv.ludecomp(e);
+            for (size_t i = 0; i < 2 * H; i++)
+            {
+                m.get(i, j) = col[i];
+            }
+        }
+
+        return m;
+    }
+    template <size_t H>
+    inline static vector<T, N> cauchy(const vector<T, N> &x, const vector<T, N> &grad, const vector<T, N> &lower, const vector<T, N> &upper,
+                                      const std::vector<vector<T, N>> &s, const std::vector<vector<T, N>> &y, const T theta,
+                                      const matrix<T, 2 * H, 2 * H> &m, vector<T, 2 * H> &c)
+    {
+        // Generalized cauchy point, first minimizer of the quadratic model along the projected gradient path
+        vector<T, N> xcp = x;
+        vector<T, N> d;
+
+        // Calculate breakpoints where each variable hits its bound
+        std::vector<std::pair<T, size_t>> breaks;
+        for (size_t i = 0; i < N; i++)
+        {
+            T t = std::numeric_limits<T>::max();
+            if (grad[i] < 0.0)
+            {
+                t = (x[i] - upper[i]) / grad[i];
+            }
+            else if (grad[i] > 0.0)
+            {
+                t = (x[i] - lower[i]) / grad[i];
+            }
+
+            // Variables already at their bound do not move
+            if (t > 0.0)
+            {
+                d[i] = -grad[i];
+                if (grad[i] != 0.0)
+                {
+                    breaks.push_back(std::make_pair(t, i));
+                }
+            }
+        }
+
+        // Visit breakpoints in order
+        std::sort(breaks.begin(), breaks.end());
+
+        // p = W'*d, c = W'*(xcp - x)
+        vector<T, 2 * H> p;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (d[i] != 0.0)
+            {
+                p += box_row<H>(s, y, theta, i) * d[i];
+            }
+        }
+        c.zero();
+
+        // First and second derivative of the model along the path
+        T fp = -d.square_magnitude();
+        T fpp = -theta * fp - p.dot(multiply(m, p));
+        const T fpp0 = fpp * 1E-10;
+        T dt_min = (fpp > 0.0) ? -fp / fpp : 0.0;
+        T t_old = 0.0;
+
+        // Search each segment between breakpoints
+        const size_t size = breaks.size();
+        size_t j = 0;
+        T dt = (size > 0) ? breaks[0].first : std::numeric_limits<T>::max();
+        while (j < size && dt_min >= dt)
+        {
+            // Variable b hits its bound
+            const size_t b = breaks[j].second;
+            const T gb = grad[b];
+            xcp[b] = (d[b] > 0.0) ? upper[b] : lower[b];
+            const T zb = xcp[b] - x[b];
+            c += p * dt;
+
+            // Update the derivatives for the next segment
+            const vector<T, 2 * H> wb = box_row<H>(s, y, theta, b);
+            fp += dt * fpp + gb * gb + theta * gb * zb - gb * wb.dot(multiply(m, c));
+            fpp += -theta * gb * gb - 2.0 * gb * wb.dot(multiply(m, p)) - gb * gb * wb.dot(multiply(m, wb));
+            fpp = std::max(fpp0, fpp);
+            p += wb * gb;
+            d[b] = 0.0;
+
+            // Calculate minimizer on this segment
+            dt_min = -fp / fpp;
+            t_old = breaks[j].first;
+            j++;
+            dt = (j < size) ? breaks[j].first - t_old : std::numeric_limits<T>::max();
+        }
+
+        // Step to the minimizer on the last segment
+        dt_min = std::max(dt_min, static_cast<T>(0.0));
+        t_old += dt_min;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (d[i] != 0.0)
+            {
+                xcp[i] = x[i] + t_old * d[i];
+            }
+        }
+        c += p * dt_min;
+
+        // Return the cauchy point
+        return xcp;
+    }
+    template <size_t H>
+    inline static vector<T, N> subspace(const vector<T, N> &x, const vector<T, N> &grad, const vector<T, N> &xcp, const vector<T, N> &lower, const vector<T, N> &upper,
+                                        const std::vector<vector<T, N>> &s, const std::vector<vector<T, N>> &y, const T theta,
+                                        const matrix<T, 2 * H, 2 * H> &m, const vector<T, 2 * H> &c)
+    {
+        // Without curvature history the cauchy point is the model minimizer
+        if (s.size() == 0)
+        {
+            return xcp;
+        }
+
+        // Reduced gradient of the model at cauchy point for free variables
+        // r = Z'*(grad + theta*(xcp - x) - W*M*c)
+        const vector<T, 2 * H> mc = multiply(m, c);
+        vector<T, N> r;
+        vector<T, 2 * H> v;
+        matrix<T, 2 * H, 2 * H> wzzw(0.0);
+        bool free = false;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (xcp[i] > lower[i] && xcp[i] < upper[i])
+            {
+                const vector<T, 2 * H> w = box_row<H>(s, y, theta, i);
+                r[i] = grad[i] + theta * (xcp[i] - x[i]) - w.dot(mc);
+                v += w * r[i];
+                free = true;
+
+                // Accumulate W'*Z*Z'*W
+                for (size_t a = 0; a < 2 * H; a++)
+                {
+                    for (size_t b = 0; b < 2 * H; b++)
+                    {
+                        wzzw.get(a, b) += w[a] * w[b];
+                    }
+                }
+            }
+        }
+
+        // All variables at bounds
+        if (!free)
+        {
+            return xcp;
+        }
+
+        // Solve reduced newton step with Sherman-Morrison-Woodbury
+        // v = (I - 1/theta*M*W'*Z*Z'*W)^-1 * M*W'*Z*r
+        const matrix<T, 2 * H, 2 * H> mw = multiply(m, wzzw);
+        matrix<T, 2 * H, 2 * H> n;
+        for (size_t a = 0; a < 2 * H; a++)
+        {
+            for (size_t b = 0; b < 2 * H; b++)
+            {
+                n.get(a, b) -= mw.get(a, b) / theta;
+            }
+        }
+        try
+        {
+            v = n.ludecomp(multiply(m, v));
+        }
+        catch (std::exception &ex)
+        {
+            return xcp;
+        }
+
+        // du = -1/theta*r - 1/theta^2*Z'*W*v, projected into box
+        vector<T, N> out = xcp;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (xcp[i] > lower[i] && xcp[i] < upper[i])
+            {
+                const T du = -r[i] / theta - box_row<H>(s, y, theta, i).dot(v) / (theta * theta);
+                out[i] = std::max(lower[i], std::min(xcp[i] + du, upper[i]));
+            }
+        }
+
+        return out;
+    }
+    inline void evaluate(thread_pool &pool, const std::vector<vector<T, N>> &x, std::vector<T> &y, const size_t begin) const
+    {
+        // Evaluate the points in range [begin, size) concurrently
+        const size_t size = x.size() - begin;
+        const auto f = [this, &x, &y, begin](const size_t i) {
+            y[begin + i] = (*this)(x[begin + i]);
+        };
+
+        pool.run(size, f);
+    }
+
   public:
     equation() : _f(nullptr) {}
     equation(const function<T, N> f) : _f(f) {}
@@ -132,6 +807,456 @@ class equation
         // Return the sum square of the x values, should be close to zero at solution
         return convergence;
     }
+
+    // Find local minimum of function
+    // This function uses the BFGS quasi-newton method with a dense inverse hessian approximation
+    // The inverse hessian is updated with a rank-2 correction from the change in gradient each iteration
+    // This costs one gradient and one O(N^2) update per iteration instead of the O(N^2) evaluations of min
+    // Recommended for mid-size problems where an N x N matrix still fits comfortably in memory
+    inline T min_bfgs(const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance) const
+    {
+        // Start with scaled identity inverse hessian
+        matrix<T, N, N> hinv;
+
+        return bfgs(x0, x1, hinv, iterations, tolerance, true);
+    }
+
+    // Find local minimum of function
+    // Same as min_bfgs but warm-starts from the inverse hessian 'hinv' of a previous solve
+    // 'hinv' is updated in place and can be passed on to the next solve
+    inline T min_bfgs(const vector<T, N> &x0, vector<T, N> &x1, matrix<T, N, N> &hinv, const size_t iterations, const T tolerance) const
+    {
+        return bfgs(x0, x1, hinv, iterations, tolerance, false);
+    }
+
+    // Find local minimum of function
+    // These functions use nonlinear conjugate gradient with an interpolating line search
+    // Only a few N-length vectors are stored, so they scale to problems where an N x N matrix is too large
+    // Each iteration costs one gradient and converges much faster than min_fast on ill-conditioned functions
+    // d = -grad(x1) + beta*d, where beta = grad(x1)*grad(x1) / grad(x0)*grad(x0)
+    inline T min_fletcher_reeves(const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance) const
+    {
+        const auto f = [](const vector<T, N> &g1, const vector<T, N> &g0, const vector<T, N> &d) {
+            return g1.square_magnitude() / g0.square_magnitude();
+        };
+
+        return conjugate(f, x0, x1, iterations, tolerance);
+    }
+    // beta = max(0, grad(x1)*(grad(x1) - grad(x0)) / grad(x0)*grad(x0))
+    inline T min_polak_ribiere(const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance) const
+    {
+        const auto f = [](const vector<T, N> &g1, const vector<T, N> &g0, const vector<T, N> &d) {
+            const T b = g1.dot(g1 - g0) / g0.square_magnitude();
+            return std::max(static_cast<T>(0.0), b);
+        };
+
+        return conjugate(f, x0, x1, iterations, tolerance);
+    }
+    // beta = (y - 2*d*|y|^2 / d*y) * grad(x1) / d*y, where y = grad(x1) - grad(x0)
+    // beta is bounded below by -1 / (|d| * min(0.01, |grad(x0)|))
+    inline T min_hager_zhang(const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance) const
+    {
+        const auto f = [](const vector<T, N> &g1, const vector<T, N> &g0, const vector<T, N> &d) {
+            const vector<T, N> y = g1 - g0;
+            const T dy = d.dot(y);
+            if (dy == 0.0)
+            {
+                return static_cast<T>(0.0);
+            }
+
+            // Calculate the beta and lower bound
+            const T b = (y - d * (2.0 * y.square_magnitude() / dy)).dot(g1) / dy;
+            const T eta = -1.0 / (std::sqrt(d.square_magnitude()) * std::min(static_cast<T>(0.01), std::sqrt(g0.square_magnitude())));
+            return std::max(eta, b);
+        };
+
+        return conjugate(f, x0, x1, iterations, tolerance);
+    }
+
+    // Find local minimum of function
+    // This function uses a trust region newton method with a Steihaug-Toint conjugate gradient subproblem
+    // Only hessian-vector products are needed, see numeric hessian_vector, so memory is O(N)
+    // Steps that increase the function are rejected, so unlike min it will not step uphill on nonconvex functions
+    inline T min_newton_cg(const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance) const
+    {
+        const auto f = [this, tolerance](const vector<T, N> &x, const vector<T, N> &grad, const T delta, const bool, T &pred) {
+            return this->steihaug(x, grad, delta, tolerance, pred);
+        };
+
+        return trust_region(f, x0, x1, iterations, tolerance);
+    }
+
+    // Find local minimum of function
+    // This function uses a trust region newton method with a dogleg subproblem
+    // The full hessian is calculated and factored after each accepted step, so this is intended for small dense problems
+    inline T min_dogleg(const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance) const
+    {
+        // The hessian and newton step are only recalculated after an accepted step
+        matrix<T, N, N> hess;
+        vector<T, N> pb;
+        bool newton = false;
+        const auto f = [this, tolerance, &hess, &pb, &newton](const vector<T, N> &x, const vector<T, N> &grad, const T delta, const bool update, T &pred) {
+            return this->dogleg(x, grad, delta, tolerance, update, hess, pb, newton, pred);
+        };
+
+        return trust_region(f, x0, x1, iterations, tolerance);
+    }
+
+    // Find local minimum of function inside the box [lower, upper]
+    // This function uses a limited memory BFGS model in the style of L-BFGS-B
+    // Each iteration finds the generalized cauchy point along the projected gradient path,
+    // then minimizes the model over the variables that are not at a bound
+    // H is the number of stored correction pairs, memory is O(H*N)
+    // The finite difference gradient may evaluate the function up to dx outside the box
+    template <size_t H = 5>
+    inline T min_box(const vector<T, N> &x0, vector<T, N> &x1, const vector<T, N> &lower, const vector<T, N> &upper, const size_t iterations, const T tolerance) const
+    {
+        // Backtracking parameters
+        const T alpha = 1E-4;
+        const T B = 0.5;
+        const T min_step = 1E-10;
+
+        // Start searching inside the box
+        x1 = project(x0, lower, upper);
+        T fx = (*this)(x1);
+        vector<T, N> grad = numeric<T, N>::gradient(*this, x1, tolerance);
+
+        // Correction pairs and compact matrix
+        std::vector<vector<T, N>> s;
+        std::vector<vector<T, N>> y;
+        s.reserve(H);
+        y.reserve(H);
+        T theta = 1.0;
+        matrix<T, 2 * H, 2 * H> m;
+
+        // Calculate the convergence criteria
+        T convergence = projected_gradient(x1, grad, lower, upper);
+
+        // Search for up to _max_iterations
+        for (size_t i = 0; i < iterations; i++)
+        {
+            // Determine if we have converged
+            if (convergence < tolerance)
+            {
+                return convergence;
+            }
+
+            // Calculate the cauchy point and minimize over the free variables
+            vector<T, 2 * H> c;
+            const vector<T, N> xcp = cauchy<H>(x1, grad, lower, upper, s, y, theta, m, c);
+            const vector<T, N> xbar = subspace<H>(x1, grad, xcp, lower, upper, s, y, theta, m, c);
+
+            // Search direction is feasible for t in [0, 1]
+            vector<T, N> dx = xbar - x1;
+            T slope = grad.dot(dx);
+
+            // Fall back to cauchy point if subspace step is not a descent direction
+            if (slope >= 0.0)
+            {
+                dx = xcp - x1;
+                slope = grad.dot(dx);
+            }
+
+            // Without history, limit the first step to unit length
+            T t = 1.0;
+            if (s.size() == 0)
+            {
+                t = std::min(static_cast<T>(1.0), 1.0 / std::sqrt(dx.square_magnitude()));
+            }
+
+            // Perform backtracking, f(x + t*dx) > f(x) + alpha*t*grad(x)*dx
+            T fx1 = (*this)(x1 + dx * t);
+            while (fx1 > fx + alpha * t * slope && t > min_step)
+            {
+                t *= B;
+                fx1 = (*this)(x1 + dx * t);
+            }
+
+            // Step to next iteration
+            const vector<T, N> x2 = project(x1 + dx * t, lower, upper);
+            const vector<T, N> grad1 = numeric<T, N>::gradient(*this, x2, tolerance);
+
+            // Store correction pair if curvature condition holds
+            const vector<T, N> sk = x2 - x1;
+            const vector<T, N> yk = grad1 - grad;
+            const T sy = sk.dot(yk);
+            const T yy = yk.square_magnitude();
+            if (sy > 1E-10 * yy)
+            {
+                // Drop oldest pair
+                if (s.size() == H)
+                {
+                    s.erase(s.begin());
+                    y.erase(y.begin());
+                }
+                s.push_back(sk);
+                y.push_back(yk);
+                theta = yy / sy;
+
+                // Update the compact matrix, reset history if it is singular
+                try
+                {
+                    m = box_middle<H>(s, y, theta);
+                }
+                catch (std::exception &ex)
+                {
+                    s.clear();
+                    y.clear();
+                    theta = 1.0;
+                    m = matrix<T, 2 * H, 2 * H>();
+                }
+            }
+
+            // Store the state for the next iteration
+            x1 = x2;
+            fx = fx1;
+            grad = grad1;
+
+            // Calculate the convergence criteria
+            convergence = projected_gradient(x1, grad, lower, upper);
+        }
+
+        // Return the sum square of the projected gradient, should be close to zero at solution
+        return convergence;
+    }
+
+    // Find local minimum of function without derivatives
+    // This function uses Nelder-Mead with dimension adaptive parameters, suitable for noisy or non-smooth functions
+    // Reflection, expansion and both contractions are evaluated concurrently when the pool has more than one thread
+    // Shrink steps evaluate all new vertices concurrently
+    // A collapsed simplex is restarted around the best vertex until the minimum stops improving
+    // Returns the spread of function values over the simplex, converged when spread and simplex size < tolerance
+    inline T min_nelder_mead(const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance) const
+    {
+        // Run on calling thread
+        thread_pool pool(1);
+
+        return min_nelder_mead(x0, x1, iterations, tolerance, pool);
+    }
+    inline T min_nelder_mead(const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance, thread_pool &pool) const
+    {
+        // Adaptive parameters for reflection, expansion, contraction and shrink
+        const T n = static_cast<T>(N);
+        const T alpha = 1.0;
+        const T beta = 1.0 + 2.0 / n;
+        const T gamma = 0.75 - 0.5 / n;
+        const T delta = 1.0 - 1.0 / n;
+
+        // Evaluate speculative trial points concurrently
+        const bool parallel = pool.get_threads() > 1;
+
+        // Create initial simplex by stepping 5% along each axis
+        std::vector<vector<T, N>> x(N + 1);
+        std::vector<T> y(N + 1);
+        const auto simplex = [this, &pool, &x, &y](const vector<T, N> &start) {
+            x.assign(N + 1, start);
+            for (size_t i = 0; i < N; i++)
+            {
+                x[i + 1][i] = (start[i] != 0.0) ? 1.05 * start[i] : 2.5E-4;
+            }
+            this->evaluate(pool, x, y, 0);
+        };
+        simplex(x0);
+
+        // Restart value, a collapsed simplex is restarted until it stops improving
+        T restart = std::numeric_limits<T>::max();
+
+        // Trial points, reflection, expansion, outside and inside contraction
+        std::vector<vector<T, N>> trial(4);
+        std::vector<T> ft(4);
+
+        // Vertex ordering
+        std::vector<size_t> order(N + 1);
+        T convergence = 0.0;
+
+        // Search for up to _max_iterations
+        for (size_t i = 0; i < iterations; i++)
+        {
+            // Sort vertices by function value
+            for (size_t j = 0; j <= N; j++)
+            {
+                order[j] = j;
+            }
+            std::sort(order.begin(), order.end(), [&y](const size_t a, const size_t b) {
+                return y[a] < y[b];
+            });
+            const size_t best = order[0];
+            const size_t worst = order[N];
+            const size_t second = order[N - 1];
+
+            // Calculate the convergence criteria
+            convergence = y[worst] - y[best];
+            T size = 0.0;
+            for (size_t j = 0; j <= N; j++)
+            {
+                size = std::max(size, (x[j] - x[best]).square_magnitude());
+            }
+
+            // Determine if we have converged
+            if (convergence < tolerance && size < tolerance * tolerance)
+            {
+                // Stop if restarting did not improve the minimum
+                if (y[best] >= restart)
+                {
+                    break;
+                }
+
+                // Restart around the best vertex
+                restart = y[best];
+                simplex(vector<T, N>(x[best]));
+                continue;
+            }
+
+            // Centroid of all vertices except the worst
+            vector<T, N> c;
+            for (size_t j = 0; j < N; j++)
+            {
+                c += x[order[j]];
+            }
+            c /= n;
+
+            // Calculate trial points
+            const vector<T, N> dir = c - x[worst];
+            trial[0] = c + dir * alpha;
+            trial[1] = c + dir * (alpha * beta);
+            trial[2] = c + dir * (alpha * gamma);
+            trial[3] = c - dir * (alpha * gamma);
+
+            // Evaluate all trial points concurrently or only the reflection
+            if (parallel)
+            {
+                evaluate(pool, trial, ft, 0);
+            }
+            else
+            {
+                ft[0] = (*this)(trial[0]);
+            }
+
+            // Choose the next vertex
+            bool shrink = false;
+            if (ft[0] < y[best])
+            {
+                // Try expansion
+                ft[1] = parallel ? ft[1] : (*this)(trial[1]);
+                const size_t k = (ft[1] < ft[0]) ? 1 : 0;
+                x[worst] = trial[k];
+                y[worst] = ft[k];
+            }
+            else if (ft[0] < y[second])
+            {
+                // Accept reflection
+                x[worst] = trial[0];
+                y[worst] = ft[0];
+            }
+            else if (ft[0] < y[worst])
+            {
+                // Try outside contraction
+                ft[2] = parallel ? ft[2] : (*this)(trial[2]);
+                shrink = ft[2] > ft[0];
+                if (!shrink)
+                {
+                    x[worst] = trial[2];
+                    y[worst] = ft[2];
+                }
+            }
+            else
+            {
+                // Try inside contraction
+                ft[3] = parallel ? ft[3] : (*this)(trial[3]);
+                shrink = ft[3] >= y[worst];
+                if (!shrink)
+                {
+                    x[worst] = trial[3];
+                    y[worst] = ft[3];
+                }
+            }
+
+            // Shrink simplex toward best vertex
+            if (shrink)
+            {
+                // Move best vertex to the front so the rest can be evaluated together
+                std::swap(x[0], x[best]);
+                std::swap(y[0], y[best]);
+                for (size_t j = 1; j <= N; j++)
+                {
+                    x[j] = x[0] + (x[j] - x[0]) * delta;
+                }
+                evaluate(pool, x, y, 1);
+            }
+        }
+
+        // Return the best vertex
+        const size_t best = std::min_element(y.begin(), y.end()) - y.begin();
+        x1 = x[best];
+
+        // Return the spread of function values in the simplex
+        return convergence;
+    }
+
+    // Find local minimum of function without derivatives
+    // This function uses a compass pattern search that polls all 2N points x +/- step*e_i concurrently
+    // The best improving point is accepted and the step expands, otherwise the step is halved
+    // Returns the final step size, converged when step < tolerance
+    inline T min_pattern(const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance) const
+    {
+        // Run on calling thread
+        thread_pool pool(1);
+
+        return min_pattern(x0, x1, iterations, tolerance, pool);
+    }
+    inline T min_pattern(const vector<T, N> &x0, vector<T, N> &x1, const size_t iterations, const T tolerance, thread_pool &pool) const
+    {
+        // Start searching for minimum of equation
+        x1 = x0;
+        T fx = (*this)(x1);
+
+        // Poll points
+        std::vector<vector<T, N>> poll(2 * N);
+        std::vector<T> fp(2 * N);
+
+        // Initial mesh size
+        T step = 1.0;
+
+        // Search for up to _max_iterations
+        for (size_t i = 0; i < iterations; i++)
+        {
+            // Determine if we have converged
+            if (step < tolerance)
+            {
+                return step;
+            }
+
+            // Create poll points along each axis
+            for (size_t j = 0; j < N; j++)
+            {
+                poll[2 * j] = x1;
+                poll[2 * j][j] += step;
+                poll[2 * j + 1] = x1;
+                poll[2 * j + 1][j] -= step;
+            }
+
+            // Poll all points concurrently
+            evaluate(pool, poll, fp, 0);
+
+            // Find the best poll point
+            const size_t best = std::min_element(fp.begin(), fp.end()) - fp.begin();
+            if (fp[best] < fx)
+            {
+                // Move to improving point and expand mesh
+                x1 = poll[best];
+                fx = fp[best];
+                step *= 2.0;
+            }
+            else
+            {
+                // Contract the mesh
+                step *= 0.5;
+            }
+        }
+
+        // Return the step size
+        return step;
+    }
 };
 } // namespace mml
 #endif
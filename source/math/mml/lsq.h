@@ -0,0 +1,231 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __LEAST_SQUARES__
+#define __LEAST_SQUARES__
+
+#include <algorithm>
+#include <mml/equation.h>
+#include <mml/mat.h>
+#include <mml/mult.h>
+#include <mml/numeric.h>
+#include <mml/vec.h>
+
+namespace mml
+{
+
+// Nonlinear least squares, min sum(r_i(x)^2) for M residuals of N parameters, M >= N
+template <typename T, size_t M, size_t N, template <typename, size_t> class numeric>
+class lsq
+{
+  private:
+    equation<T, N, numeric> _residuals[M];
+    size_t _max_iterations;
+    T _tolerance;
+    bool _geodesic;
+
+    inline vector<T, N> solve(const matrix<T, N, N> &jtj, const vector<T, N> &v, const T lambda) const
+    {
+        // Damp the normal equations, (J'J + lambda*diag(J'J))*x = v
+        matrix<T, N, N> A = jtj;
+        for (size_t i = 0; i < N; i++)
+        {
+            A.get(i, i) += lambda * std::max(jtj.get(i, i), static_cast<T>(1E-12));
+        }
+
+        return A.ludecomp(v);
+    }
+
+  public:
+    lsq(const equation<T, N, numeric> eqs[M])
+        : _max_iterations(100), _tolerance(1E-4), _geodesic(false)
+    {
+        // Assert we have enough residuals
+        static_assert(M >= N, "lsq: need at least as many residuals as parameters");
+
+        // Copy all functions
+        for (size_t i = 0; i < M; i++)
+        {
+            _residuals[i] = eqs[i];
+        }
+    }
+    inline matrix<T, M, N> jacobian(const vector<T, N> &x, const T dx) const
+    {
+        // J_ij = dr_i/dx_j
+        matrix<T, M, N> jac;
+
+        // Evaluate gradient for all residuals in range [0, M)
+        for (size_t i = 0; i < M; i++)
+        {
+            // Calculate the gradient for ith row
+            const vector<T, N> grad = numeric<T, N>::gradient(_residuals[i], x, dx);
+
+            // Assign gradient values along this row
+            for (size_t j = 0; j < N; j++)
+            {
+                jac.get(i, j) = grad[j];
+            }
+        }
+
+        // Return jacobian matrix of residuals
+        return jac;
+    }
+    inline vector<T, M> evaluate(const vector<T, N> &x) const
+    {
+        vector<T, M> out;
+
+        // Evaluate all residuals
+        for (size_t i = 0; i < M; i++)
+        {
+            out[i] = _residuals[i](x);
+        }
+
+        return out;
+    }
+    inline void set_geodesic(const bool mode)
+    {
+        _geodesic = mode;
+    }
+    inline void set_max_iterations(const size_t iterations)
+    {
+        _max_iterations = iterations;
+    }
+    inline void set_tolerance(const T tolerance)
+    {
+        _tolerance = tolerance;
+    }
+    // Uses damped Levenberg-Marquardt to find the least squares minimum of the residuals
+    // Only the residual jacobian is calculated, the hessian is approximated by J'J
+    // If geodesic acceleration is enabled, a second order correction along the step is added
+    // for one extra residual evaluation, which helps in long narrow valleys
+    inline T min(const vector<T, N> &x0, vector<T, N> &x1) const
+    {
+        // Start searching for minimum of residuals
+        x1 = x0;
+
+        // Damping parameters
+        const T tau = 1E-3;
+        const T accel_ratio = 0.75;
+        const T h = 0.1;
+        T nu = 2.0;
+        T lambda = -1.0;
+
+        // Evaluate residuals at starting point
+        vector<T, M> r = evaluate(x1);
+        T cost = r.square_magnitude();
+
+        // The jacobian and normal equations only change when a step is accepted
+        matrix<T, M, N> jac;
+        matrix<T, N, M> jac_t;
+        matrix<T, N, N> jtj;
+        vector<T, N> g;
+        bool moved = true;
+
+        // Search for up to _max_iterations
+        for (size_t i = 0; i < _max_iterations; i++)
+        {
+            if (moved)
+            {
+                // Calculate the jacobian matrix at x1
+                jac = this->jacobian(x1, _tolerance);
+                jac_t = jac.transpose();
+
+                // Calculate normal equations
+                jtj = multiply(jac_t, jac);
+                g = multiply(jac_t, r);
+                moved = false;
+            }
+
+            // Determine if we have converged
+            if (g.square_magnitude() < _tolerance)
+            {
+                break;
+            }
+
+            // Initial damping scaled to largest diagonal
+            if (lambda < 0.0)
+            {
+                T max = 0.0;
+                for (size_t j = 0; j < N; j++)
+                {
+                    max = std::max(max, jtj.get(j, j));
+                }
+                lambda = tau * max;
+            }
+
+            // Calculate the Levenberg-Marquardt velocity step
+            const vector<T, N> v = solve(jtj, g * -1.0, lambda);
+            vector<T, N> step = v;
+
+            // Add geodesic acceleration, r'' ~ 2/h * ((r(x + h*v) - r(x)) / h - J*v)
+            if (_geodesic)
+            {
+                const vector<T, M> rh = evaluate(x1 + v * h);
+                const vector<T, M> rvv = ((rh - r) / h - multiply(jac, v)) * (2.0 / h);
+                const vector<T, N> a = solve(jtj, multiply(jac_t, rvv) * -1.0, lambda);
+
+                // Only accept acceleration if small compared to velocity
+                const T ratio = 2.0 * std::sqrt(a.square_magnitude() / v.square_magnitude());
+                if (ratio <= accel_ratio)
+                {
+                    step += a * 0.5;
+                }
+            }
+
+            // Evaluate the residuals at trial point
+            const vector<T, N> x2 = x1 + step;
+            const vector<T, M> r2 = evaluate(x2);
+            const T cost2 = r2.square_magnitude();
+
+            // Predicted reduction of linear model, v'*(lambda*D*v - g)
+            T pred = 0.0;
+            for (size_t j = 0; j < N; j++)
+            {
+                pred += v[j] * (lambda * std::max(jtj.get(j, j), static_cast<T>(1E-12)) * v[j] - g[j]);
+            }
+
+            // Gain ratio of actual to predicted reduction
+            const T rho = (pred > 0.0) ? (cost - cost2) / pred : -1.0;
+            if (rho > 0.0)
+            {
+                // Accept step, reduce damping toward gauss-newton
+                x1 = x2;
+                r = r2;
+                cost = cost2;
+                moved = true;
+                const T s = 2.0 * rho - 1.0;
+                lambda *= std::max(static_cast<T>(1.0 / 3.0), 1.0 - s * s * s);
+                nu = 2.0;
+
+                // Determine if the step has stalled
+                if (step.square_magnitude() < _tolerance * _tolerance)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                // Reject step, increase damping toward steepest descent
+                lambda *= nu;
+                nu *= 2.0;
+            }
+        }
+
+        // Return the sum square of the residuals
+        return cost;
+    }
+};
+} // namespace mml
+
+#endif
@@ -18,6 +18,7 @@ limitations under the License.
 #include <algorithm>
 #include <cmath>
 #include <mml/vec.h>
+#include <stdexcept>
 #include <type_traits>
 
 namespace mml
@@ -27,6 +28,10 @@ namespace mml
 template <typename T, size_t R, size_t C>
 class matrix;
 
+// Forward declaration of lu_matrix
+template <typename T, size_t N>
+class lu_matrix;
+
 // Partial specialization functions not allowed! So use a class!
 template <typename T, size_t R, size_t C>
 class det_matrix
@@ -96,6 +101,8 @@ class det_matrix<T, 2, 2>
 template <typename T, size_t R, size_t C>
 class matrix
 {
+    friend class lu_matrix<T, R>;
+
   private:
     T _mat[R][C];
 
@@ -202,7 +209,7 @@ class matrix
         out[R - 1] = v[o[R - 1]] / get(o[R - 1], R - 1);
 
         // Upper diagonal matrix row product
-        for (int i = R - 2; i > -1; i--)
+        for (int i = static_cast<int>(R) - 2; i > -1; i--)
         {
             T sum = 0.0;
             for (size_t j = i + 1; j < C; j++)
@@ -425,6 +432,38 @@ class matrix
         return out;
     }
 };
+
+// Reusable LU decomposition, factor once and solve [A]{X} = {B} for many B
+template <typename T, size_t N>
+class lu_matrix
+{
+  private:
+    matrix<T, N, N> _lu;
+    size_t _o[N];
+    T _s[N];
+
+  public:
+    lu_matrix()
+    {
+        // Decomposition of the identity matrix
+        for (size_t i = 0; i < N; i++)
+        {
+            _o[i] = i;
+            _s[i] = 1.0;
+        }
+    }
+    lu_matrix(const matrix<T, N, N> &A) : _lu(A)
+    {
+        // Throws on singular matrix like matrix.ludecomp()
+        _lu.decompose(_o, _s);
+    }
+    inline vector<T, N> solve(const vector<T, N> &v) const
+    {
+        // Substitution modifies a copy of v
+        vector<T, N> B = v;
+        return _lu.substitute(_o, B);
+    }
+};
 } // namespace mml
 
 #endif
@@ -0,0 +1,339 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __MULTISTART__
+#define __MULTISTART__
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <mml/equation.h>
+#include <mml/pool.h>
+#include <mml/vec.h>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace mml
+{
+
+// Sobol low discrepancy sequence in up to 21 dimensions
+// Direction numbers from Joe and Kuo, dimension 0 is the van der Corput sequence
+template <size_t N>
+class sobol
+{
+  private:
+    static constexpr size_t _bits = 32;
+    static constexpr size_t _max_dims = 21;
+    uint32_t _v[N][_bits];
+    uint32_t _x[N];
+    size_t _count;
+
+  public:
+    sobol() : _count(0)
+    {
+        // Assert dimensions are supported
+        static_assert(N <= _max_dims, "sobol: only 21 dimensions are supported");
+
+        // Degree and coefficients of primitive polynomials
+        static const unsigned s[_max_dims] = {0, 1, 2, 3, 3, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6, 7, 7};
+        static const unsigned a[_max_dims] = {0, 0, 1, 1, 2, 1, 4, 2, 4, 7, 11, 13, 14, 1, 13, 16, 19, 22, 25, 1, 4};
+        static const unsigned m[_max_dims][7] = {
+            {0, 0, 0, 0, 0, 0, 0}, {1, 0, 0, 0, 0, 0, 0}, {1, 3, 0, 0, 0, 0, 0}, {1, 3, 1, 0, 0, 0, 0}, {1, 1, 1, 0, 0, 0, 0},
+            {1, 1, 3, 3, 0, 0, 0}, {1, 3, 5, 13, 0, 0, 0}, {1, 1, 5, 5, 17, 0, 0}, {1, 1, 5, 5, 5, 0, 0}, {1, 1, 7, 11, 19, 0, 0},
+            {1, 1, 5, 1, 1, 0, 0}, {1, 1, 1, 3, 11, 0, 0}, {1, 3, 5, 5, 31, 0, 0}, {1, 3, 3, 9, 7, 49, 0}, {1, 1, 1, 15, 21, 21, 0},
+            {1, 3, 1, 13, 27, 49, 0}, {1, 1, 1, 15, 7, 5, 0}, {1, 3, 1, 15, 13, 25, 0}, {1, 1, 5, 5, 19, 61, 0}, {1, 3, 7, 11, 23, 15, 103},
+            {1, 3, 7, 13, 13, 15, 69}};
+
+        // Calculate direction numbers for each dimension
+        for (size_t i = 0; i < N; i++)
+        {
+            _x[i] = 0;
+            if (i == 0)
+            {
+                // van der Corput sequence
+                for (size_t k = 0; k < _bits; k++)
+                {
+                    _v[i][k] = 1u << (_bits - 1 - k);
+                }
+                continue;
+            }
+
+            // Initial direction numbers
+            const unsigned deg = s[i];
+            for (size_t k = 0; k < deg; k++)
+            {
+                _v[i][k] = m[i][k] << (_bits - 1 - k);
+            }
+
+            // Recurrence from primitive polynomial
+            for (size_t k = deg; k < _bits; k++)
+            {
+                uint32_t v = _v[i][k - deg] ^ (_v[i][k - deg] >> deg);
+                for (size_t j = 1; j < deg; j++)
+                {
+                    if ((a[i] >> (deg - 1 - j)) & 1)
+                    {
+                        v ^= _v[i][k - j];
+                    }
+                }
+                _v[i][k] = v;
+            }
+        }
+    }
+    // Returns the next point in the unit hypercube, the origin is skipped
+    template <typename T>
+    inline vector<T, N> next()
+    {
+        // Index of rightmost zero bit, gray code ordering
+        size_t c = 0;
+        size_t n = _count;
+        while (n & 1)
+        {
+            n >>= 1;
+            c++;
+        }
+        _count++;
+
+        // Update each dimension
+        vector<T, N> out;
+        const T scale = 1.0 / 4294967296.0;
+        for (size_t i = 0; i < N; i++)
+        {
+            _x[i] ^= _v[i][c];
+            out[i] = static_cast<T>(_x[i]) * scale;
+        }
+
+        return out;
+    }
+};
+
+// Parallel multi-start global minimization inside a box
+// Start points are sampled with a sobol sequence or latin hypercube and sorted by function value
+// Starts are skipped when a better start or a found minimum is within the critical distance, (MLSL)
+// Local solves run on a work stealing thread pool, and the best unique minima are returned
+template <typename T, size_t N, template <typename, size_t> class numeric>
+class multistart
+{
+  private:
+    equation<T, N, numeric> _f;
+    vector<T, N> _lower;
+    vector<T, N> _upper;
+    std::function<T(const vector<T, N> &, vector<T, N> &)> _local;
+    size_t _starts;
+    size_t _iterations;
+    T _tolerance;
+    T _radius;
+    bool _sobol;
+    std::mt19937 _rgen;
+
+    inline std::vector<vector<T, N>> latin()
+    {
+        std::vector<vector<T, N>> out(_starts);
+        std::uniform_real_distribution<T> dist(0.0, 1.0);
+
+        // Each dimension uses a random permutation of strata
+        std::vector<size_t> strata(_starts);
+        const T inv_starts = 1.0 / _starts;
+        for (size_t i = 0; i < N; i++)
+        {
+            for (size_t j = 0; j < _starts; j++)
+            {
+                strata[j] = j;
+            }
+            std::shuffle(strata.begin(), strata.end(), _rgen);
+
+            // Random offset inside each stratum
+            for (size_t j = 0; j < _starts; j++)
+            {
+                out[j][i] = (strata[j] + dist(_rgen)) * inv_starts;
+            }
+        }
+
+        return out;
+    }
+    inline std::vector<vector<T, N>> sequence() const
+    {
+        std::vector<vector<T, N>> out(_starts);
+
+        // Low discrepancy sobol points
+        sobol<N> seq;
+        for (size_t i = 0; i < _starts; i++)
+        {
+            out[i] = seq.template next<T>();
+        }
+
+        return out;
+    }
+    inline T critical_distance() const
+    {
+        // r = 1/sqrt(pi) * (gamma(1 + N/2) * volume * sigma * log(k) / k)^(1/N)
+        const T pi = 3.14159265358979323846;
+        const T sigma = 2.0;
+        const T k = static_cast<T>(_starts);
+        T volume = 1.0;
+        for (size_t i = 0; i < N; i++)
+        {
+            volume *= _upper[i] - _lower[i];
+        }
+
+        return std::pow(std::tgamma(1.0 + 0.5 * N) * volume * sigma * std::log(k) / k, 1.0 / N) / std::sqrt(pi);
+    }
+
+  public:
+    multistart(const equation<T, N, numeric> &f, const vector<T, N> &lower, const vector<T, N> &upper)
+        : _f(f), _lower(lower), _upper(upper), _starts(64), _iterations(100), _tolerance(1E-7), _radius(-1.0), _sobol(true),
+          _rgen(std::chrono::high_resolution_clock::now().time_since_epoch().count())
+    {
+        // Default local solver is box constrained L-BFGS
+        _local = [this](const vector<T, N> &x0, vector<T, N> &x1) {
+            return this->_f.min_box(x0, x1, this->_lower, this->_upper, this->_iterations, this->_tolerance);
+        };
+    }
+    multistart(const multistart<T, N, numeric> &) = delete;
+    multistart<T, N, numeric> &operator=(const multistart<T, N, numeric> &) = delete;
+    // Returns up to k unique local minima sorted from best to worst as (f(x), x) pairs
+    inline std::vector<std::pair<T, vector<T, N>>> min(const size_t k, thread_pool &pool)
+    {
+        // Sample start points in unit hypercube
+        const std::vector<vector<T, N>> unit = (_sobol) ? sequence() : latin();
+
+        // Map to box and evaluate start points concurrently
+        std::vector<vector<T, N>> starts(_starts);
+        std::vector<T> values(_starts);
+        const auto sample = [this, &unit, &starts, &values](const size_t i) {
+            starts[i] = _lower + (_upper - _lower) * unit[i];
+            values[i] = _f(starts[i]);
+        };
+        pool.run(_starts, sample);
+
+        // Process best starts first
+        std::vector<size_t> order(_starts);
+        for (size_t i = 0; i < _starts; i++)
+        {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&values](const size_t a, const size_t b) {
+            return values[a] < values[b];
+        });
+
+        // Critical distance for skipping starts and merging minima
+        const T r = (_radius > 0.0) ? _radius : critical_distance();
+        const T r2 = r * r;
+        const T merge2 = 1E-6 * (_upper - _lower).square_magnitude();
+
+        // Minima found so far
+        std::vector<std::pair<T, vector<T, N>>> minima;
+        std::mutex lock;
+
+        // Run local solves
+        const auto solve = [this, &order, &starts, &values, &minima, &lock, r2, merge2](const size_t i) {
+            const size_t s = order[i];
+            const vector<T, N> &x0 = starts[s];
+
+            // Skip if a better start is within the critical distance
+            for (size_t j = 0; j < i; j++)
+            {
+                const size_t b = order[j];
+                if (values[b] < values[s] && (starts[b] - x0).square_magnitude() < r2)
+                {
+                    return;
+                }
+            }
+
+            // Skip if start is in the basin of a found minimum
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                for (const auto &m : minima)
+                {
+                    if (m.first <= values[s] && (m.second - x0).square_magnitude() < r2)
+                    {
+                        return;
+                    }
+                }
+            }
+
+            // Run the local solver
+            vector<T, N> x1;
+            _local(x0, x1);
+            const T y1 = _f(x1);
+
+            // Merge with an existing minimum or record a new one
+            std::lock_guard<std::mutex> guard(lock);
+            for (auto &m : minima)
+            {
+                if ((m.second - x1).square_magnitude() < merge2)
+                {
+                    if (y1 < m.first)
+                    {
+                        m = std::make_pair(y1, x1);
+                    }
+                    return;
+                }
+            }
+            minima.push_back(std::make_pair(y1, x1));
+        };
+        pool.run(_starts, solve);
+
+        // Sort minima and keep the best k
+        std::sort(minima.begin(), minima.end(), [](const std::pair<T, vector<T, N>> &a, const std::pair<T, vector<T, N>> &b) {
+            return a.first < b.first;
+        });
+        if (minima.size() > k)
+        {
+            minima.resize(k);
+        }
+
+        return minima;
+    }
+    inline void seed(const unsigned seed)
+    {
+        _rgen.seed(seed);
+    }
+    inline void set_latin()
+    {
+        _sobol = false;
+    }
+    inline void set_local(const std::function<T(const vector<T, N> &, vector<T, N> &)> &local)
+    {
+        _local = local;
+    }
+    inline void set_iterations(const size_t iterations)
+    {
+        _iterations = iterations;
+    }
+    inline void set_radius(const T radius)
+    {
+        _radius = radius;
+    }
+    inline void set_sobol()
+    {
+        _sobol = true;
+    }
+    inline void set_starts(const size_t starts)
+    {
+        _starts = starts;
+    }
+    inline void set_tolerance(const T tolerance)
+    {
+        _tolerance = tolerance;
+    }
+};
+} // namespace mml
+
+#endif
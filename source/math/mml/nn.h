@@ -15,8 +15,11 @@ limitations under the License.
 #ifndef __NEURAL_NET__
 #define __NEURAL_NET__
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <new>
 #include <random>
 #include <vector>
 
@@ -87,5 +90,303 @@ class net_rng
         _rgen.seed(std::chrono::high_resolution_clock::now().time_since_epoch().count());
     }
 };
+
+// Allocator aligning storage to A bytes, so parameter buffers start on a cache line
+template <typename T, size_t A = 64>
+class aligned_allocator
+{
+  public:
+    typedef T value_type;
+    template <typename U>
+    struct rebind
+    {
+        typedef aligned_allocator<U, A> other;
+    };
+    aligned_allocator() {}
+    template <typename U>
+    aligned_allocator(const aligned_allocator<U, A> &) {}
+    inline T *allocate(const size_t n)
+    {
+        // Over allocate and store the original pointer just before the aligned block
+        void *const raw = ::operator new(n * sizeof(T) + A + sizeof(void *));
+        const uintptr_t start = reinterpret_cast<uintptr_t>(raw) + sizeof(void *);
+        const uintptr_t aligned = (start + A - 1) & ~static_cast<uintptr_t>(A - 1);
+        reinterpret_cast<void **>(aligned)[-1] = raw;
+
+        return reinterpret_cast<T *>(aligned);
+    }
+    inline void deallocate(T *p, const size_t n)
+    {
+        ::operator delete(reinterpret_cast<void **>(p)[-1]);
+    }
+};
+template <typename T, typename U, size_t A>
+inline bool operator==(const aligned_allocator<T, A> &, const aligned_allocator<U, A> &)
+{
+    return true;
+}
+template <typename T, typename U, size_t A>
+inline bool operator!=(const aligned_allocator<T, A> &, const aligned_allocator<U, A> &)
+{
+    return false;
+}
+
+// Aligned contiguous storage for nnet parameters and activations
+template <typename T>
+using nnbuffer = std::vector<T, aligned_allocator<T>>;
+
+// Row major [W] (rows x cols) kernels used by nnet, 'y = b + [W]{x}'
+template <typename T>
+inline void nn_gemv(const T *W, const T *b, const T *x, T *y, const size_t rows, const size_t cols)
+{
+    for (size_t i = 0; i < rows; i++)
+    {
+        // Dot product of weight row with x, starting from the bias
+        const T *const w = W + i * cols;
+        T sum = b[i];
+        for (size_t j = 0; j < cols; j++)
+        {
+            sum += w[j] * x[j];
+        }
+        y[i] = sum;
+    }
+}
+// 'y = [W]^T{d}', accumulated row by row so the inner loop is contiguous
+template <typename T>
+inline void nn_gemv_transpose(const T *W, const T *d, T *y, const size_t rows, const size_t cols)
+{
+    std::fill(y, y + cols, 0.0);
+    for (size_t i = 0; i < rows; i++)
+    {
+        const T *const w = W + i * cols;
+        const T di = d[i];
+        for (size_t j = 0; j < cols; j++)
+        {
+            y[j] += di * w[j];
+        }
+    }
+}
+// Rank one update '[W] -= step * {d}{x}^T' and 'b -= step * d'
+template <typename T>
+inline void nn_ger(T *W, T *b, const T *d, const T *x, const size_t rows, const size_t cols, const T step_size)
+{
+    for (size_t i = 0; i < rows; i++)
+    {
+        T *const w = W + i * cols;
+        const T step = step_size * d[i];
+        for (size_t j = 0; j < cols; j++)
+        {
+            w[j] -= step * x[j];
+        }
+        b[i] -= step;
+    }
+}
+
+// Batched kernels, sample s of a batch is row s of a matrix with the given stride
+// 'Y = X[W]^T + b' for a batch of inputs X, tiles of four samples share each weight row
+template <typename T>
+inline void nn_gemm(const T *W, const T *b, const T *X, T *Y, const size_t rows, const size_t cols, const size_t batch, const size_t x_stride, const size_t y_stride)
+{
+    size_t s = 0;
+    for (; s + 4 <= batch; s += 4)
+    {
+        const T *const x0 = X + s * x_stride;
+        const T *const x1 = x0 + x_stride;
+        const T *const x2 = x1 + x_stride;
+        const T *const x3 = x2 + x_stride;
+        T *const y = Y + s * y_stride;
+
+        // Two weight rows at a time give eight independent sums
+        size_t i = 0;
+        for (; i + 2 <= rows; i += 2)
+        {
+            const T *const w = W + i * cols;
+            const T *const v = w + cols;
+            T sum0 = b[i];
+            T sum1 = b[i];
+            T sum2 = b[i];
+            T sum3 = b[i];
+            T sum4 = b[i + 1];
+            T sum5 = b[i + 1];
+            T sum6 = b[i + 1];
+            T sum7 = b[i + 1];
+            for (size_t j = 0; j < cols; j++)
+            {
+                const T wj = w[j];
+                const T vj = v[j];
+                sum0 += wj * x0[j];
+                sum1 += wj * x1[j];
+                sum2 += wj * x2[j];
+                sum3 += wj * x3[j];
+                sum4 += vj * x0[j];
+                sum5 += vj * x1[j];
+                sum6 += vj * x2[j];
+                sum7 += vj * x3[j];
+            }
+            y[i] = sum0;
+            y[i + y_stride] = sum1;
+            y[i + 2 * y_stride] = sum2;
+            y[i + 3 * y_stride] = sum3;
+            y[i + 1] = sum4;
+            y[i + 1 + y_stride] = sum5;
+            y[i + 1 + 2 * y_stride] = sum6;
+            y[i + 1 + 3 * y_stride] = sum7;
+        }
+
+        // Remaining row
+        for (; i < rows; i++)
+        {
+            const T *const w = W + i * cols;
+            T sum0 = b[i];
+            T sum1 = b[i];
+            T sum2 = b[i];
+            T sum3 = b[i];
+            for (size_t j = 0; j < cols; j++)
+            {
+                const T wj = w[j];
+                sum0 += wj * x0[j];
+                sum1 += wj * x1[j];
+                sum2 += wj * x2[j];
+                sum3 += wj * x3[j];
+            }
+            y[i] = sum0;
+            y[i + y_stride] = sum1;
+            y[i + 2 * y_stride] = sum2;
+            y[i + 3 * y_stride] = sum3;
+        }
+    }
+
+    // Remaining samples
+    for (; s < batch; s++)
+    {
+        nn_gemv<T>(W, b, X + s * x_stride, Y + s * y_stride, rows, cols);
+    }
+}
+// Accumulates a four by sixteen register tile 'acc += A B' over n, A(k, i) is A[k * a_k + i * a_n] and B(i, l) is B[i * b_n + l]
+template <typename T>
+inline void nn_tile(const T *A, const size_t a_k, const size_t a_n, const T *B, const size_t b_n, const size_t n, T acc[4][16])
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        const T *const b = B + i * b_n;
+        const T a0 = A[i * a_n];
+        const T a1 = A[a_k + i * a_n];
+        const T a2 = A[2 * a_k + i * a_n];
+        const T a3 = A[3 * a_k + i * a_n];
+        for (size_t l = 0; l < 16; l++)
+        {
+            const T bl = b[l];
+            acc[0][l] += a0 * bl;
+            acc[1][l] += a1 * bl;
+            acc[2][l] += a2 * bl;
+            acc[3][l] += a3 * bl;
+        }
+    }
+}
+// 'P = D[W]' for a batch of deltas D
+// Register tiles of four samples by sixteen columns are accumulated over all weight rows
+template <typename T>
+inline void nn_gemm_transpose(const T *W, const T *D, T *P, const size_t rows, const size_t cols, const size_t batch, const size_t d_stride, const size_t p_stride)
+{
+    size_t s = 0;
+    for (; s + 4 <= batch; s += 4)
+    {
+        const T *const d = D + s * d_stride;
+        T *const p = P + s * p_stride;
+        size_t j = 0;
+        for (; j + 16 <= cols; j += 16)
+        {
+            T acc[4][16] = {};
+            nn_tile<T>(d, d_stride, 1, W + j, cols, rows, acc);
+            for (size_t k = 0; k < 4; k++)
+            {
+                std::copy(acc[k], acc[k] + 16, p + k * p_stride + j);
+            }
+        }
+
+        // Remaining columns
+        for (; j < cols; j++)
+        {
+            for (size_t k = 0; k < 4; k++)
+            {
+                T sum = 0.0;
+                for (size_t i = 0; i < rows; i++)
+                {
+                    sum += d[i + k * d_stride] * W[i * cols + j];
+                }
+                p[k * p_stride + j] = sum;
+            }
+        }
+    }
+
+    // Remaining samples
+    for (; s < batch; s++)
+    {
+        nn_gemv_transpose<T>(W, D + s * d_stride, P + s * p_stride, rows, cols);
+    }
+}
+// Accumulates gradients '[G] += D^T X' and 'g += sum(D)' over a batch
+// Register tiles of four rows by sixteen columns are accumulated over all samples
+template <typename T>
+inline void nn_gemm_gradient(T *G, T *g, const T *D, const T *X, const size_t rows, const size_t cols, const size_t batch, const size_t d_stride, const size_t x_stride)
+{
+    size_t i = 0;
+    for (; i + 4 <= rows; i += 4)
+    {
+        size_t j = 0;
+        for (; j + 16 <= cols; j += 16)
+        {
+            T acc[4][16] = {};
+            nn_tile<T>(D + i, 1, d_stride, X + j, x_stride, batch, acc);
+            for (size_t k = 0; k < 4; k++)
+            {
+                T *const gw = G + (i + k) * cols + j;
+                for (size_t l = 0; l < 16; l++)
+                {
+                    gw[l] += acc[k][l];
+                }
+            }
+        }
+
+        // Remaining columns
+        for (; j < cols; j++)
+        {
+            for (size_t k = 0; k < 4; k++)
+            {
+                T sum = 0.0;
+                for (size_t s = 0; s < batch; s++)
+                {
+                    sum += D[s * d_stride + i + k] * X[s * x_stride + j];
+                }
+                G[(i + k) * cols + j] += sum;
+            }
+        }
+    }
+
+    // Remaining rows
+    for (; i < rows; i++)
+    {
+        T *const gw = G + i * cols;
+        for (size_t s = 0; s < batch; s++)
+        {
+            const T *const x = X + s * x_stride;
+            const T d = D[s * d_stride + i];
+            for (size_t j = 0; j < cols; j++)
+            {
+                gw[j] += d * x[j];
+            }
+        }
+    }
+
+    // Bias gradient
+    for (size_t s = 0; s < batch; s++)
+    {
+        const T *const d = D + s * d_stride;
+        for (size_t k = 0; k < rows; k++)
+        {
+            g[k] += d[k];
+        }
+    }
+}
 } // namespace mml
 #endif
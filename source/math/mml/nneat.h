@@ -19,6 +19,7 @@ limitations under the License.
 #include <functional>
 #include <iostream>
 #include <map>
+#include <mml/activation.h>
 #include <mml/nn.h>
 #include <mml/vec.h>
 #include <vector>
@@ -43,17 +44,7 @@ class nanode
     }
     inline static T transfer_sigmoid(const T input)
     {
-        const T arg = -1.0 * input;
-        if (arg > 20.0)
-        {
-            return 0.0;
-        }
-        else if (arg < -20.0)
-        {
-            return 1.0;
-        }
-
-        return 1.0 / (1.0 + std::exp(arg));
+        return act_sigmoid<T>(input);
     }
 
   public:
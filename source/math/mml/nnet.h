@@ -16,473 +16,763 @@ limitations under the License.
 #define __NEURAL_NET_FIXED__
 
 #include <algorithm>
-#include <functional>
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <mml/activation.h>
 #include <mml/nn.h>
+#include <mml/pool.h>
 #include <mml/vec.h>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace mml
 {
 
-template <typename T>
-class nnode
+// Activation of a layer, chosen when the layer is added
+// Inherit layers use the activation of the calculate_* and backprop_* call, or identity for calculate and backprop
+class nnactivation
+{
+  public:
+    static constexpr unsigned inherit = 0;
+    static constexpr unsigned identity = 1;
+    static constexpr unsigned sigmoid = 2;
+    static constexpr unsigned tanh = 3;
+    static constexpr unsigned softplus = 4;
+    static constexpr unsigned relu = 5;
+    static constexpr unsigned leaky_relu = 6;
+    static constexpr unsigned gelu = 7;
+};
+
+// Dimensions of a layer and the offsets of its data in the nnet buffers
+// Weights are a row major (size x inputs) matrix followed by the bias vector
+// Layers that need their input for backprop keep it in a second block after the output, otherwise both offsets are equal
+class nnlayer
 {
   private:
-    static constexpr T _weight_range = 1E6;
-    std::vector<T> _weights;
-    std::vector<T> _delta_weights;
-    mutable std::vector<T> _inputs;
-    T _bias;
-    mutable T _sum;
-    mutable T _output;
-    T _delta;
+    size_t _size;
+    size_t _inputs;
+    size_t _weights;
+    size_t _bias;
+    size_t _output;
+    size_t _preactivation;
+    unsigned _activation;
 
-    inline static void range(T &weight)
-    {
-        weight = std::max(-_weight_range, std::min(weight, _weight_range));
-    }
-    inline static T transfer_deriv_identity(const T output)
+  public:
+    nnlayer(const size_t size, const size_t inputs, const size_t weights, const size_t bias, const size_t output, const size_t preactivation, const unsigned activation)
+        : _size(size), _inputs(inputs), _weights(weights), _bias(bias), _output(output), _preactivation(preactivation), _activation(activation) {}
+    inline unsigned activation() const
     {
-        return 1.0;
+        return _activation;
     }
-    inline static T transfer_identity(const T input)
+    inline size_t bias() const
     {
-        return input;
+        return _bias;
     }
-    inline static T transfer_deriv_relu(const T output)
+    inline size_t inputs() const
     {
-        const T arg = -1.0 * output;
-        if (arg > 20.0)
-        {
-            return 0.0;
-        }
-        else if (arg < -20.0)
-        {
-            return 1.0;
-        }
-
-        return 1.0 / (1.0 + std::exp(arg));
+        return _inputs;
     }
-    inline static T transfer_relu(const T input)
+    inline size_t output() const
     {
-        return std::log(1.0 + std::exp(input));
+        return _output;
     }
-    inline static T transfer_deriv_sigmoid(const T output)
+    inline size_t preactivation() const
     {
-        return output * (1.0 - output);
+        return _preactivation;
     }
-    inline static T transfer_sigmoid(const T input)
+    inline size_t size() const
     {
-        const T arg = -1.0 * input;
-        if (arg > 20.0)
-        {
-            return 0.0;
-        }
-        else if (arg < -20.0)
-        {
-            return 1.0;
-        }
-
-        return 1.0 / (1.0 + std::exp(arg));
+        return _size;
     }
-    inline static T transfer_deriv_tanh(const T output)
+    inline size_t weights() const
     {
-        return 1.0 - (output * output);
+        return _weights;
     }
-    inline static T transfer_tanh(const T input)
-    {
-        const T arg = -2.0 * input;
-        if (arg > 20.0)
-        {
-            return 0.0;
-        }
-        else if (arg < -20.0)
-        {
-            return 1.0;
-        }
+};
 
-        return (2.0 / (1.0 + std::exp(arg))) - 1.0;
-    }
-    inline void backprop(const T step_size)
-    {
-        // Calculate the delta sum term
-        const size_t size = _inputs.size();
-        for (size_t i = 0; i < size; i++)
-        {
-            _delta_weights[i] = (_delta * _weights[i]);
-        }
+// Caller owned scratch buffers for evaluating a shared nnet without touching its state
+// One workspace per thread lets any number of threads query one read-only net
+template <typename T>
+class nnet_workspace
+{
+    template <typename U, size_t IN, size_t OUT>
+    friend class nnet;
 
-        // Calculate step by step size
-        const T step = step_size * _delta;
+  private:
+    nnbuffer<T> _params;
+    nnbuffer<T> _input;
+    nnbuffer<T> _activation;
+    nnbuffer<T> _delta;
+    nnbuffer<T> _propagate;
+    nnbuffer<T> _gradient;
 
-        // Update weights
-        for (size_t i = 0; i < size; i++)
-        {
-            // Update weights
-            _weights[i] -= (step * _inputs[i]);
-        }
+  public:
+    nnet_workspace() {}
+};
 
-        // Update bias
-        _bias -= step;
-    }
-    inline void zero() const
+template <typename T, size_t IN, size_t OUT>
+class nnet
+{
+  private:
+    static constexpr T _weight_range = 1E6;
+    static constexpr size_t _align = 64 / sizeof(T);
+    static constexpr unsigned _sgd = 0;
+    static constexpr unsigned _momentum = 1;
+    static constexpr unsigned _nesterov = 2;
+    static constexpr unsigned _rmsprop = 3;
+    static constexpr unsigned _adam = 4;
+    mutable vector<T, IN> _input;
+    mutable vector<T, OUT> _output;
+    std::vector<nnlayer> _layers;
+    nnbuffer<T> _params;
+    mutable nnbuffer<T> _activation;
+    nnbuffer<T> _delta;
+    nnbuffer<T> _propagate;
+    nnbuffer<T> _gradient;
+    mutable size_t _batch;
+    mutable nnbuffer<T> _batch_input;
+    mutable nnbuffer<T> _batch_activation;
+    nnbuffer<T> _batch_delta;
+    nnbuffer<T> _batch_propagate;
+    std::vector<nnet_workspace<T>> _workers;
+    bool _final;
+    bool _linear_output;
+    size_t _interval;
+
+    // Optimizer state is parallel to the parameter buffer
+    unsigned _optimizer;
+    T _beta1;
+    T _beta2;
+    T _epsilon;
+    T _decay;
+    size_t _time;
+    nnbuffer<T> _moment;
+    nnbuffer<T> _second;
+
+    inline static size_t pad(const size_t size)
     {
-        _sum = _bias;
-        _output = 0.0;
+        // Round up so every block starts on a cache line
+        return ((size + _align - 1) / _align) * _align;
     }
-
-  public:
-    nnode(const size_t size)
-        : _weights(size, 1.0), _delta_weights(size, 0), _inputs(size, 0),
-          _bias(0.0), _sum(0.0), _output(0.0), _delta(0.0) {}
-    inline void reset(mml::net_rng<T> &ran)
+    inline static void range(T &weight)
     {
-        // Randomize weights
-        for (T &w : _weights)
-        {
-            w = ran.random();
-        }
-
-        // Zero out weights vectors
-        std::fill(_delta_weights.begin(), _delta_weights.end(), 0.0);
-        std::fill(_inputs.begin(), _inputs.end(), 0.0);
-
-        // Reset node values
-        _bias = ran.random();
-        _sum = 0.0;
-        _output = 0.0;
-        _delta = 0.0;
+        weight = std::max(-_weight_range, std::min(weight, static_cast<T>(_weight_range)));
     }
-    inline nnode<T> &operator*=(const nnode<T> &n)
+    inline static void transfer_deriv_relu(const T *output, T *delta, const size_t size)
     {
-        const size_t size = n._weights.size();
         for (size_t i = 0; i < size; i++)
         {
-            // average weights
-            _weights[i] = (_weights[i] + n._weights[i]) * 0.5;
-
-            // Check for weight overflow
-            range(_weights[i]);
+            // dj = 1.0/(1.0+exp(-x)) * propagated
+            delta[i] = act_sigmoid<T>(output[i]) * delta[i];
         }
-
-        // average bias
-        _bias = (_bias + n._bias) * 0.5;
-
-        // Check for bias overflow
-        range(_bias);
-
-        return *this;
     }
-    inline void backprop_identity(const T propagated, const T step_size)
+    inline static void transfer_relu(T *x, const size_t size)
     {
-        // propagated = sum(dk * Wjk) or if last layer (Ok - tk)
-        // dj = 1.0 * propagated
-        _delta = transfer_deriv_identity(_output) * propagated;
-
-        // Calculate steps for weights and biases
-        backprop(step_size);
+        // Softplus, log(1.0 + exp(x))
+        act_softplus<T>(x, size);
     }
-    inline void backprop_relu(const T propagated, const T step_size)
+    inline static void transfer_deriv_sigmoid(const T *output, T *delta, const size_t size)
     {
-        // propagated = sum(dk * Wjk) or if last layer (Ok - tk)
-        // dj = 1.0/(1.0+exp(-x)) * propagated
-        _delta = transfer_deriv_relu(_output) * propagated;
-
-        // Calculate steps for weights and biases
-        backprop(step_size);
+        for (size_t i = 0; i < size; i++)
+        {
+            // dj = (Oj) * (1.0 - Oj) * propagated
+            delta[i] = (output[i] * (1.0 - output[i])) * delta[i];
+        }
     }
-    inline void backprop_sigmoid(const T propagated, const T step_size)
+    inline static void transfer_sigmoid(T *x, const size_t size)
     {
-        // propagated = sum(dk * Wjk) or if last layer (Ok - tk)
-        // dj = (Oj) * (1.0 - Oj) * propagated
-        _delta = transfer_deriv_sigmoid(_output) * propagated;
-
-        // Calculate steps for weights and biases
-        backprop(step_size);
+        act_sigmoid<T>(x, size);
     }
-    inline void backprop_tanh(const T propagated, const T step_size)
+    inline static void transfer_deriv_tanh(const T *output, T *delta, const size_t size)
     {
-        // propagated = sum(dk * Wjk) or if last layer (Ok - tk)
-        // dj = (1.0 - (Oj * Oj)) * propagated
-        _delta = transfer_deriv_tanh(_output) * propagated;
-
-        // Calculate steps for weights and biases
-        backprop(step_size);
+        for (size_t i = 0; i < size; i++)
+        {
+            // dj = (1.0 - (Oj * Oj)) * propagated
+            delta[i] = (1.0 - (output[i] * output[i])) * delta[i];
+        }
     }
-    inline void calculate_identity() const
+    inline static void transfer_tanh(T *x, const size_t size)
     {
-        // Calculate transfer
-        _output = transfer_identity(_sum);
+        act_tanh<T>(x, size);
     }
-    inline void calculate_relu() const
+    inline static void transfer_deriv_gelu(const T *input, T *delta, const size_t size)
     {
-        // Calculate transfer
-        _output = transfer_relu(_sum);
+        for (size_t i = 0; i < size; i++)
+        {
+            // dj = (0.5 * (1.0 + t) + 0.5 * x * (1.0 - t * t) * du/dx) * propagated
+            const T x = input[i];
+            const T t = act_tanh<T>(0.7978845608028654 * (x + 0.044715 * x * x * x));
+            const T du = 0.7978845608028654 * (1.0 + 0.134145 * x * x);
+            delta[i] = (0.5 * (1.0 + t) + 0.5 * x * (1.0 - t * t) * du) * delta[i];
+        }
     }
-    inline void calculate_sigmoid() const
+    inline static void transfer_deriv_leaky_relu(const T *output, T *delta, const size_t size)
     {
-        // Calculate transfer
-        _output = transfer_sigmoid(_sum);
+        for (size_t i = 0; i < size; i++)
+        {
+            // Output has the sign of the input
+            delta[i] = (output[i] > 0.0) ? delta[i] : 0.01 * delta[i];
+        }
     }
-    inline void calculate_tanh() const
+    inline static void transfer_deriv_rectifier(const T *output, T *delta, const size_t size)
     {
-        // Calculate transfer
-        _output = transfer_tanh(_sum);
+        for (size_t i = 0; i < size; i++)
+        {
+            delta[i] = (output[i] > 0.0) ? delta[i] : 0.0;
+        }
     }
-    inline T delta(const size_t index) const
+    inline static void transfer_deriv_softplus(const T *output, T *delta, const size_t size)
     {
-        // dk * Wjk in backprop
-        return _delta_weights[index];
+        for (size_t i = 0; i < size; i++)
+        {
+            // dj = 1.0/(1.0+exp(-x)) = 1.0 - exp(-Oj) * propagated
+            delta[i] = (1.0 - act_exp<T>(-output[i])) * delta[i];
+        }
     }
-    inline T get_bias() const
+    inline unsigned activation(const size_t i) const
     {
-        return _bias;
+        // A linear output overrides an inherited activation of the last layer
+        const unsigned a = _layers[i].activation();
+        return (a == nnactivation::inherit && _linear_output && i == _layers.size() - 1) ? nnactivation::identity : a;
     }
-    inline size_t get_inputs() const
+    inline void activate(const size_t i, void (*transfer)(T *, const size_t), T *y, T *z) const
     {
-        return _weights.size();
+        // Dispatch once for the whole layer
+        const size_t size = _layers[i].size();
+        switch (activation(i))
+        {
+        case nnactivation::inherit:
+            if (transfer)
+            {
+                transfer(y, size);
+            }
+            break;
+        case nnactivation::identity:
+            break;
+        case nnactivation::sigmoid:
+            act_sigmoid<T>(y, size);
+            break;
+        case nnactivation::tanh:
+            act_tanh<T>(y, size);
+            break;
+        case nnactivation::softplus:
+            act_softplus<T>(y, size);
+            break;
+        case nnactivation::relu:
+            act_relu<T>(y, size);
+            break;
+        case nnactivation::leaky_relu:
+            act_leaky_relu<T>(y, size);
+            break;
+        case nnactivation::gelu:
+            // Keep the layer input for backprop
+            std::copy(y, y + size, z);
+            act_gelu<T>(y, size);
+            break;
+        }
     }
-    inline const std::vector<T> &get_weights() const
+    inline void derive(const size_t i, void (*deriv)(const T *, T *, const size_t), const T *y, const T *z, T *delta) const
     {
-        return _weights;
+        // Multiply delta by the derivative of layer i, from its output y or input z
+        const size_t size = _layers[i].size();
+        switch (activation(i))
+        {
+        case nnactivation::inherit:
+            if (deriv)
+            {
+                deriv(y, delta, size);
+            }
+            break;
+        case nnactivation::identity:
+            break;
+        case nnactivation::sigmoid:
+            transfer_deriv_sigmoid(y, delta, size);
+            break;
+        case nnactivation::tanh:
+            transfer_deriv_tanh(y, delta, size);
+            break;
+        case nnactivation::softplus:
+            transfer_deriv_softplus(y, delta, size);
+            break;
+        case nnactivation::relu:
+            transfer_deriv_rectifier(y, delta, size);
+            break;
+        case nnactivation::leaky_relu:
+            transfer_deriv_leaky_relu(y, delta, size);
+            break;
+        case nnactivation::gelu:
+            transfer_deriv_gelu(z, delta, size);
+            break;
+        }
     }
-    inline std::vector<T> &get_weights()
+    inline void backprop(void (*deriv)(const T *, T *, const size_t), const vector<T, OUT> &set_point, const T step_size)
     {
-        return _weights;
+        // We assume the network is in calculated state
+        backprop(deriv, set_point, step_size, &_input[0], _activation.data(), _delta.data(), _propagate.data(), _params.data());
     }
-    void mutate(mml::net_rng<T> &ran)
+    inline void backprop(void (*deriv)(const T *, T *, const size_t), const vector<T, OUT> &set_point, const T step_size,
+                         const T *input, const T *activation, T *delta, T *propagate, T *params)
     {
-        // Calculate a mutation type
-        const unsigned r = ran.random_int();
+        // If we are in a valid state
+        if (!_layers.empty())
+        {
+            // Do backprop for last layer first
+            const size_t last = _layers.size() - 1;
 
-        // calculate random weight index
-        const unsigned index = ran.random_int() % _weights.size();
+            // Check that last layer is the appropriate size
+            if (_layers[last].size() != OUT)
+            {
+                throw std::runtime_error("nnet: backprop invalid output dimension");
+            }
 
-        // Mutate the node based on type
-        if (r % 2 == 0)
-        {
-            // Mutate the weight with mult
-            _weights[index] *= ran.mutation();
+            // Optimizers other than sgd need the whole gradient before updating
+            if (_optimizer != _sgd)
+            {
+                std::fill(_gradient.begin(), _gradient.end(), 0.0);
+            }
+
+            // Output error, propagated = (Ok - tk) for the last layer
+            const T *const output = activation + _layers[last].output();
+            for (size_t i = 0; i < OUT; i++)
+            {
+                delta[i] = output[i] - set_point[i];
+            }
+
+            // A linear output node has unit derivative
+            derive(last, deriv, output, activation + _layers[last].preactivation(), delta);
+
+            // For all layers, iterating backwards
+            for (size_t i = last + 1; i-- > 0;)
+            {
+                const nnlayer &layer = _layers[i];
+                T *const W = params + layer.weights();
+                T *const b = params + layer.bias();
+                const T *const x = (i == 0) ? input : activation + _layers[i - 1].output();
+
+                // Propagate delta sum, dk * Wjk, to previous layer before updating weights
+                if (i > 0)
+                {
+                    nn_gemv_transpose<T>(W, delta, propagate, layer.size(), layer.inputs());
+                    derive(i - 1, deriv, x, activation + _layers[i - 1].preactivation(), propagate);
+                }
+
+                // Update weights and bias, or accumulate the gradient for the optimizer
+                if (_optimizer == _sgd)
+                {
+                    nn_ger<T>(W, b, delta, x, layer.size(), layer.inputs(), step_size);
+                }
+                else
+                {
+                    nn_ger<T>(&_gradient[layer.weights()], &_gradient[layer.bias()], delta, x, layer.size(), layer.inputs(), -1.0);
+                }
+
+                // Propagated delta becomes the delta of the previous layer
+                std::swap(delta, propagate);
+            }
+
+            // One optimizer step with the sample gradient
+            if (_optimizer != _sgd)
+            {
+                update(_gradient.data(), 1.0, step_size);
+            }
         }
-        else if (r % 3 == 0)
+        else
         {
-            // Mutate the bias with mult
-            _bias += ran.mutation();
+            throw std::runtime_error("nnet: can't backprop, not enough layers");
         }
-        else if (r % 5 == 0)
+    }
+    inline void backprop(void (*deriv)(const T *, T *, const size_t), const std::vector<vector<T, OUT>> &set_point, const T step_size)
+    {
+        // We assume the network is in calculated state for this batch
+        if (_layers.empty())
         {
-            // Mutate the weight with add
-            _weights[index] += ran.mutation();
+            throw std::runtime_error("nnet: can't backprop, not enough layers");
         }
-        else if (r % 7 == 0)
+        else if (_layers.back().size() != OUT)
         {
-            // Mutate the bias with add
-            _bias *= ran.mutation();
+            throw std::runtime_error("nnet: backprop invalid output dimension");
         }
-        else if (r % 11 == 0)
+        const size_t batch = set_point.size();
+        if (batch != _batch || batch == 0)
         {
-            // Assign random values
-            _weights[index] = ran.random();
-            _bias = ran.random();
+            throw std::runtime_error("nnet: backprop batch size does not match calculated batch");
         }
 
-        // Check for weight and bias overflow
-        range(_weights[index]);
-        range(_bias);
-    }
-    inline T output() const
-    {
-        return _output;
+        // One update with the batch averaged gradient
+        gradient(deriv, set_point.data(), batch, _batch_input, _batch_activation, _batch_delta, _batch_propagate, _gradient.data(), _params.data());
+        update(_gradient.data(), 1.0 / batch, step_size);
     }
-    inline void reset() const
+    inline void gradient(void (*deriv)(const T *, T *, const size_t), const vector<T, OUT> *set_point, const size_t batch,
+                         const nnbuffer<T> &batch_input, const nnbuffer<T> &batch_activation, nnbuffer<T> &batch_delta, nnbuffer<T> &batch_propagate, T *gradient,
+                         const T *params) const
     {
-        // Reset the node
-        zero();
-    }
-    inline void set_bias(const T bias)
-    {
-        _bias = bias;
-    }
-    inline void sum(const T input, const size_t index) const
-    {
-        // Store input for later
-        _inputs[index] = input;
+        // Each sample is one row of the batch delta buffers
+        const size_t stride = pad(_delta.size());
+        batch_delta.resize(batch * stride);
+        batch_propagate.resize(batch * stride);
+        T *delta = batch_delta.data();
+        T *propagate = batch_propagate.data();
+
+        // Output error of each sample, propagated = (Ok - tk)
+        const size_t last = _layers.size() - 1;
+        const size_t out_stride = pad(OUT);
+        const T *const output = &batch_activation[batch * _layers[last].output()];
+        const T *const input = &batch_activation[batch * _layers[last].preactivation()];
+        for (size_t s = 0; s < batch; s++)
+        {
+            T *const d = delta + s * stride;
+            const T *const o = output + s * out_stride;
+            for (size_t i = 0; i < OUT; i++)
+            {
+                d[i] = o[i] - set_point[s][i];
+            }
 
-        // Sum input
-        _sum += input * _weights[index];
-    }
-};
+            // A linear output node has unit derivative
+            derive(last, deriv, o, input + s * out_stride, d);
+        }
 
-template <typename T>
-class nnlayer
-{
-  private:
-    std::vector<nnode<T>> _nodes;
-    size_t _inputs;
+        // Accumulate the gradient of all layers, weights are not touched
+        std::fill(gradient, gradient + _params.size(), 0.0);
+        for (size_t i = last + 1; i-- > 0;)
+        {
+            const nnlayer &layer = _layers[i];
+            const T *const W = params + layer.weights();
+            const T *const X = (i == 0) ? batch_input.data() : &batch_activation[batch * _layers[i - 1].output()];
+            const size_t x_stride = (i == 0) ? pad(IN) : pad(layer.inputs());
 
-  public:
-    nnlayer(const size_t size, const size_t inputs) : _nodes(size, inputs), _inputs(inputs) {}
-    inline size_t size() const
-    {
-        return _nodes.size();
+            // Propagate delta sums to previous layer
+            if (i > 0)
+            {
+                nn_gemm_transpose<T>(W, delta, propagate, layer.size(), layer.inputs(), batch, stride, stride);
+                const T *const Z = &batch_activation[batch * _layers[i - 1].preactivation()];
+                for (size_t s = 0; s < batch; s++)
+                {
+                    derive(i - 1, deriv, X + s * x_stride, Z + s * x_stride, propagate + s * stride);
+                }
+            }
+
+            // Sum gradient over the batch
+            nn_gemm_gradient<T>(gradient + layer.weights(), gradient + layer.bias(), delta, X, layer.size(), layer.inputs(), batch, stride, x_stride);
+
+            // Propagated delta becomes the delta of the previous layer
+            std::swap(delta, propagate);
+        }
     }
-    inline size_t inputs() const
+    inline void update(const T *gradient, const T scale, const T step_size)
     {
-        return _inputs;
+        // Apply the optimizer to the gradient scaled by 'scale', each optimizer is one fused pass over all parameters
+        const size_t size = _params.size();
+        T *const p = _params.data();
+        if (_optimizer == _sgd)
+        {
+            const T step = step_size * scale;
+            for (size_t i = 0; i < size; i++)
+            {
+                p[i] -= step * gradient[i];
+            }
+            return;
+        }
+
+        // Lazily allocate optimizer state
+        if (_moment.size() != size)
+        {
+            _moment.assign(size, 0.0);
+            _second.assign(size, 0.0);
+            _time = 0;
+        }
+        _time++;
+        T *const m = _moment.data();
+        T *const v = _second.data();
+        const T b1 = _beta1;
+        const T b2 = _beta2;
+        const T eps = _epsilon;
+        switch (_optimizer)
+        {
+        case _momentum:
+            for (size_t i = 0; i < size; i++)
+            {
+                // v = mu * v + g, p -= step * v
+                m[i] = b1 * m[i] + scale * gradient[i];
+                p[i] -= step_size * m[i];
+            }
+            break;
+        case _nesterov:
+            for (size_t i = 0; i < size; i++)
+            {
+                // v = mu * v + g, p -= step * (g + mu * v)
+                const T g = scale * gradient[i];
+                m[i] = b1 * m[i] + g;
+                p[i] -= step_size * (g + b1 * m[i]);
+            }
+            break;
+        case _rmsprop:
+            for (size_t i = 0; i < size; i++)
+            {
+                // s = rho * s + (1 - rho) * g^2, p -= step * g / (sqrt(s) + eps)
+                const T g = scale * gradient[i];
+                v[i] = b2 * v[i] + (1.0 - b2) * g * g;
+                p[i] -= step_size * g / (std::sqrt(v[i]) + eps);
+            }
+            break;
+        case _adam:
+        {
+            // Bias corrections of the first and second moments, decay is decoupled from the gradient (AdamW)
+            const T c1 = 1.0 / (1.0 - std::pow(b1, static_cast<T>(_time)));
+            const T c2 = 1.0 / (1.0 - std::pow(b2, static_cast<T>(_time)));
+            const T decay = step_size * _decay;
+            for (size_t i = 0; i < size; i++)
+            {
+                const T g = scale * gradient[i];
+                m[i] = b1 * m[i] + (1.0 - b1) * g;
+                v[i] = b2 * v[i] + (1.0 - b2) * g * g;
+                p[i] -= step_size * (m[i] * c1) / (std::sqrt(v[i] * c2) + eps) + decay * p[i];
+            }
+            break;
+        }
+        }
     }
-    inline nnode<T> &operator[](const size_t n)
+    inline void optimizer(const unsigned optimizer, const T beta1, const T beta2, const T epsilon, const T decay)
     {
-        return _nodes[n];
+        // Changing the optimizer restarts its state
+        _optimizer = optimizer;
+        _beta1 = beta1;
+        _beta2 = beta2;
+        _epsilon = epsilon;
+        _decay = decay;
+        _time = 0;
+        _moment.clear();
+        _second.clear();
     }
-    inline const nnode<T> &operator[](const size_t n) const
+    inline void train(void (*transfer)(T *, const size_t), void (*deriv)(const T *, T *, const size_t),
+                      const std::vector<vector<T, IN>> &input, const std::vector<vector<T, OUT>> &set_point, const T step_size, thread_pool &pool)
     {
-        return _nodes[n];
-    }
-};
+        const size_t batch = input.size();
+        if (batch != set_point.size() || batch == 0)
+        {
+            throw std::runtime_error("nnet: train input and set point sizes differ");
+        }
+        else if (!_layers.empty() && _layers.back().size() != OUT)
+        {
+            throw std::runtime_error("nnet: backprop invalid output dimension");
+        }
 
-template <typename T, size_t IN, size_t OUT>
-class nnet
-{
-  private:
-    mutable vector<T, IN> _input;
-    mutable vector<T, OUT> _output;
-    std::vector<nnlayer<T>> _layers;
-    bool _final;
-    bool _linear_output;
+        // One shard per thread, shard bounds only depend on the batch size and thread count
+        const size_t shards = std::min(pool.get_threads(), batch);
+        _workers.resize(shards);
+        pool.run(shards, [this, transfer, deriv, &input, &set_point, batch, shards](const size_t k) {
+            const size_t begin = (batch * k) / shards;
+            const size_t end = (batch * (k + 1)) / shards;
+            nnet_workspace<T> &work = _workers[k];
+            work._gradient.resize(_params.size());
+            forward(transfer, &input[begin], end - begin, work._input, work._activation, _params.data());
+            gradient(deriv, &set_point[begin], end - begin, work._input, work._activation, work._delta, work._propagate, work._gradient.data(), _params.data());
+        });
+
+        // Pairwise tree reduction of shard gradients into the first shard, summation order is fixed
+        for (size_t width = 1; width < shards; width *= 2)
+        {
+            const size_t pairs = (shards + 2 * width - 1) / (2 * width);
+            pool.run(pairs, [this, width, shards](const size_t k) {
+                const size_t i = 2 * width * k;
+                const size_t j = i + width;
+                if (j < shards)
+                {
+                    const size_t size = _params.size();
+                    T *const a = _workers[i]._gradient.data();
+                    const T *const b = _workers[j]._gradient.data();
+                    for (size_t l = 0; l < size; l++)
+                    {
+                        a[l] += b[l];
+                    }
+                }
+            });
+        }
 
-    inline void backprop(const std::function<void(nnode<T> &, const T, const T)> &back, const vector<T, OUT> &set_point, const T step_size)
+        // One update with the batch averaged gradient
+        update(_workers[0]._gradient.data(), 1.0 / batch, step_size);
+    }
+    inline void hogwild(void (*transfer)(T *, const size_t), void (*deriv)(const T *, T *, const size_t),
+                        const std::vector<vector<T, IN>> &input, const std::vector<vector<T, OUT>> &set_point, const T step_size, thread_pool &pool)
     {
-        // We assume the network is in calculated state
+        const size_t size = input.size();
+        if (size != set_point.size())
+        {
+            throw std::runtime_error("nnet: hogwild input and set point sizes differ");
+        }
+        else if (_optimizer != _sgd)
+        {
+            throw std::runtime_error("nnet: hogwild requires the sgd optimizer");
+        }
+        else if (!_final)
+        {
+            throw std::runtime_error("nnet: can't calculate, must finalize net");
+        }
+        else if (_layers.empty())
+        {
+            throw std::runtime_error("nnet: can't backprop, not enough layers");
+        }
+        else if (_layers.back().size() != OUT)
+        {
+            throw std::runtime_error("nnet: backprop invalid output dimension");
+        }
 
-        // If we are in a valid state
-        if (_layers.size() >= 2)
+        // Threads share the weights through relaxed atomics, racing updates may be lost but no access is a data race
+        const size_t params = _params.size();
+        std::unique_ptr<std::atomic<T>[]> shared(new std::atomic<T>[params]);
+        for (size_t i = 0; i < params; i++)
         {
-            // Do backprop for last layer first
-            const size_t last = _layers.size() - 1;
+            shared[i].store(_params[i], std::memory_order_relaxed);
+        }
 
-            // Check that last layer is the appropriate size
-            const size_t last_size = _layers[last].size();
-            if (last_size != OUT)
+        // Each thread walks its own shard of samples with its own workspace
+        const size_t shards = std::min(pool.get_threads(), size);
+        _workers.resize(shards);
+        pool.run(shards, [this, transfer, deriv, &input, &set_point, step_size, size, shards, params, &shared](const size_t k) {
+            const size_t begin = (size * k) / shards;
+            const size_t end = (size * (k + 1)) / shards;
+            nnet_workspace<T> &work = _workers[k];
+            work._params.resize(params);
+            work._gradient.resize(params);
+            work._input.resize(IN);
+            work._activation.resize(_activation.size());
+            work._delta.resize(_delta.size());
+            work._propagate.resize(_propagate.size());
+
+            // Local weights p train serially, base b is the shared state they were last synced with
+            T *const p = work._params.data();
+            T *const b = work._gradient.data();
+            for (size_t i = 0; i < params; i++)
             {
-                throw std::runtime_error("nnet: backprop invalid output dimension");
+                p[i] = b[i] = shared[i].load(std::memory_order_relaxed);
             }
-
-            // If we want a linear output node
-            if (_linear_output)
+            for (size_t s = begin; s < end; s++)
             {
-                // For all nodes in last layer
-                for (size_t i = 0; i < last_size; i++)
+                for (size_t i = 0; i < IN; i++)
                 {
-                    const T error = _layers[last][i].output() - set_point[i];
-
-                    // Do backprop for node in last layer
-                    _layers[last][i].backprop_identity(error, step_size);
+                    work._input[i] = input[s][i];
                 }
-            }
-            else
-            {
-                // For all nodes in last layer
-                for (size_t i = 0; i < last_size; i++)
-                {
-                    const T error = _layers[last][i].output() - set_point[i];
+                calculate(transfer, work._input.data(), work._activation.data(), p);
+                backprop(deriv, set_point[s], step_size, work._input.data(), work._activation.data(), work._delta.data(), work._propagate.data(), p);
 
-                    // Do backprop for node in last layer
-                    back(_layers[last][i], error, step_size);
+                // Publish the local change and pick up the updates of other threads
+                if ((s - begin + 1) % _interval == 0 || s + 1 == end)
+                {
+                    for (size_t i = 0; i < params; i++)
+                    {
+                        const T w = shared[i].load(std::memory_order_relaxed) + (p[i] - b[i]);
+                        shared[i].store(w, std::memory_order_relaxed);
+                        p[i] = b[i] = w;
+                    }
                 }
             }
+        });
 
-            // For all internal layers, iterating backwards
-            const size_t layers = _layers.size();
-            for (size_t i = 1; i < layers; i++)
+        // Copy the trained weights back, run returns after every shard finished
+        for (size_t i = 0; i < params; i++)
+        {
+            _params[i] = shared[i].load(std::memory_order_relaxed);
+        }
+    }
+    inline void forward(void (*transfer)(T *, const size_t), const vector<T, IN> *input, const size_t batch, nnbuffer<T> &batch_input, nnbuffer<T> &batch_activation,
+                        const T *params) const
+    {
+        if (!_final)
+        {
+            throw std::runtime_error("nnet: can't calculate, must finalize net");
+        }
+        else if (_layers.empty())
+        {
+            throw std::runtime_error("nnet: can't calculate, not enough layers");
+        }
+
+        // Copy inputs into rows of the batch input buffer
+        const size_t in_stride = pad(IN);
+        batch_input.resize(batch * in_stride);
+        batch_activation.resize(batch * _activation.size());
+        for (size_t s = 0; s < batch; s++)
+        {
+            for (size_t i = 0; i < IN; i++)
             {
-                size_t current = last - i;
-                const size_t nodes = _layers[current].size();
-                for (size_t j = 0; j < nodes; j++)
-                {
-                    // For all nodes in layer, calculate delta summation
-                    T sum = 0.0;
-                    const size_t size_out = _layers[current + 1].size();
-                    for (size_t k = 0; k < size_out; k++)
-                    {
-                        sum += _layers[current + 1][k].delta(j);
-                    }
+                batch_input[s * in_stride + i] = input[s][i];
+            }
+        }
 
-                    // Do backprop for this node
-                    back(_layers[current][j], sum, step_size);
-                }
+        // Propagate the batch through all layers, one matrix product per layer
+        const size_t last = _layers.size() - 1;
+        const T *X = batch_input.data();
+        size_t x_stride = in_stride;
+        for (size_t i = 0; i <= last; i++)
+        {
+            const nnlayer &layer = _layers[i];
+            const size_t y_stride = pad(layer.size());
+            T *const Y = &batch_activation[batch * layer.output()];
+            T *const Z = &batch_activation[batch * layer.preactivation()];
+            nn_gemm<T>(params + layer.weights(), params + layer.bias(), X, Y, layer.size(), layer.inputs(), batch, x_stride, y_stride);
+
+            // Activate each sample, unless we want a linear output node
+            for (size_t s = 0; s < batch; s++)
+            {
+                activate(i, transfer, Y + s * y_stride, Z + s * y_stride);
             }
+            X = Y;
+            x_stride = y_stride;
         }
-        else
+    }
+    inline std::vector<vector<T, OUT>> calculate(void (*transfer)(T *, const size_t), const std::vector<vector<T, IN>> &input, nnbuffer<T> &batch_input, nnbuffer<T> &batch_activation) const
+    {
+        const size_t batch = input.size();
+        forward(transfer, input.data(), batch, batch_input, batch_activation, _params.data());
+
+        // Map last layer to output of net
+        const size_t stride = pad(OUT);
+        const T *const Y = &batch_activation[batch * _layers.back().output()];
+        std::vector<vector<T, OUT>> out(batch);
+        for (size_t s = 0; s < batch; s++)
         {
-            throw std::runtime_error("nnet: can't backprop, not enough layers");
+            for (size_t i = 0; i < OUT; i++)
+            {
+                out[s][i] = Y[s * stride + i];
+            }
         }
+
+        return out;
     }
-    inline vector<T, OUT> calculate(const std::function<void(const nnode<T> &)> &calc) const
+    inline std::vector<vector<T, OUT>> calculate(void (*transfer)(T *, const size_t), const std::vector<vector<T, IN>> &input) const
     {
+        // Keep the batch activations for backprop
+        _batch = input.size();
+        return calculate(transfer, input, _batch_input, _batch_activation);
+    }
+    inline vector<T, OUT> calculate(void (*transfer)(T *, const size_t), const T *input, T *activation, const T *params) const
+    {
+        vector<T, OUT> out;
         if (_final)
         {
             // If we added any layers
-            if (_layers.size() >= 2)
+            if (!_layers.empty())
             {
-                // For each node in first layer
-                const size_t in_nodes = _layers[0].size();
-                for (size_t i = 0; i < in_nodes; i++)
-                {
-                    // Reset the layer node
-                    _layers[0][i].reset();
-
-                    // Map input to first layer of net
-                    for (size_t j = 0; j < IN; j++)
-                    {
-                        // Calculate sum of inputs
-                        _layers[0][i].sum(_input[j], j);
-                    }
-                }
-
-                // Do N-1 propagations from first layer
-                const size_t layers = _layers.size() - 1;
-                for (size_t i = 0; i < layers; i++)
+                // Propagate input through all layers, first layer reads the net input
+                const size_t last = _layers.size() - 1;
+                const T *x = input;
+                for (size_t i = 0; i <= last; i++)
                 {
-                    // For all nodes in out_layer
-                    const size_t size_out = _layers[i + 1].size();
-                    for (size_t j = 0; j < size_out; j++)
-                    {
-                        // Reset the layer node
-                        _layers[i + 1][j].reset();
-
-                        // For all nodes in in_layer
-                        const size_t size_in = _layers[i].size();
-                        for (size_t k = 0; k < size_in; k++)
-                        {
-                            calc(_layers[i][k]);
-                            _layers[i + 1][j].sum(_layers[i][k].output(), k);
-                        }
-                    }
+                    // Weight matrix times activation vector of previous layer
+                    const nnlayer &layer = _layers[i];
+                    T *const y = activation + layer.output();
+                    nn_gemv<T>(params + layer.weights(), params + layer.bias(), x, y, layer.size(), layer.inputs());
+
+                    // Activate each node exactly once, unless we want a linear output node
+                    activate(i, transfer, y, activation + layer.preactivation());
+                    x = y;
                 }
 
                 // Map last layer to output of net
-                // Last layer is special and added during finalize so we can just grab the output value
-                // From the last internal layer for the output
-
-                // If we want a linear output node
-                if (_linear_output)
-                {
-                    const nnlayer<T> &last = _layers.back();
-                    for (size_t i = 0; i < OUT; i++)
-                    {
-                        last[i].calculate_identity();
-                        _output[i] = last[i].output();
-                    }
-                }
-                else
+                for (size_t i = 0; i < OUT; i++)
                 {
-                    const nnlayer<T> &last = _layers.back();
-                    for (size_t i = 0; i < OUT; i++)
-                    {
-                        calc(last[i]);
-                        _output[i] = last[i].output();
-                    }
+                    out[i] = x[i];
                 }
             }
             else
@@ -495,53 +785,106 @@ class nnet
             throw std::runtime_error("nnet: can't calculate, must finalize net");
         }
 
+        return out;
+    }
+    inline vector<T, OUT> calculate(void (*transfer)(T *, const size_t)) const
+    {
+        // Keep the activations for backprop
+        _output = calculate(transfer, &_input[0], _activation.data(), _params.data());
         return _output;
     }
-    inline void on_net(const std::function<void(nnode<T> &, const size_t, const size_t)> &f)
+    inline vector<T, OUT> calculate(void (*transfer)(T *, const size_t), const vector<T, IN> &input, nnet_workspace<T> &work) const
     {
-        // For all net layers
-        const size_t layers = _layers.size();
-        for (size_t i = 0; i < layers; i++)
+        // Only the workspace is written, the net is untouched
+        work._input.resize(IN);
+        work._activation.resize(_activation.size());
+        for (size_t i = 0; i < IN; i++)
         {
-            // For all layer nodes
-            const size_t nodes = _layers[i].size();
-            for (size_t j = 0; j < nodes; j++)
-            {
-                f(_layers[i][j], i, j);
-            }
+            work._input[i] = input[i];
         }
+        return calculate(transfer, work._input.data(), work._activation.data(), _params.data());
     }
-    inline void on_const_net(const std::function<void(const nnode<T> &, const size_t, const size_t)> &f) const
+    inline void mutate(T *weights, T &bias, const size_t inputs, mml::net_rng<T> &ran)
     {
-        // For all net layers
-        const size_t layers = _layers.size();
-        for (size_t i = 0; i < layers; i++)
+        // Calculate a mutation type
+        const unsigned r = ran.random_int();
+
+        // calculate random weight index
+        const unsigned index = ran.random_int() % inputs;
+
+        // Mutate the node based on type
+        if (r % 2 == 0)
         {
-            // For all layer nodes
-            const size_t nodes = _layers[i].size();
-            for (size_t j = 0; j < nodes; j++)
-            {
-                f(_layers[i][j], i, j);
-            }
+            // Mutate the weight with mult
+            weights[index] *= ran.mutation();
         }
+        else if (r % 3 == 0)
+        {
+            // Mutate the bias with mult
+            bias += ran.mutation();
+        }
+        else if (r % 5 == 0)
+        {
+            // Mutate the weight with add
+            weights[index] += ran.mutation();
+        }
+        else if (r % 7 == 0)
+        {
+            // Mutate the bias with add
+            bias *= ran.mutation();
+        }
+        else if (r % 11 == 0)
+        {
+            // Assign random values
+            weights[index] = ran.random();
+            bias = ran.random();
+        }
+
+        // Check for weight and bias overflow
+        range(weights[index]);
+        range(bias);
     }
 
   public:
-    nnet() : _final(false), _linear_output(false) {}
-    inline void add_layer(const size_t size)
+    nnet()
+        : _batch(0), _final(false), _linear_output(false), _interval(16),
+          _optimizer(_sgd), _beta1(0.9), _beta2(0.999), _epsilon(1E-8), _decay(0.0), _time(0) {}
+    inline void add_layer(const size_t size, const unsigned activation = nnactivation::inherit)
     {
-        if (!_final)
+        if (activation > nnactivation::gelu)
+        {
+            throw std::runtime_error("nnet: invalid layer activation");
+        }
+        else if (!_final)
         {
             // If first layer
             size_t inputs = IN;
+            size_t output = 0;
             if (_layers.size() != 0)
             {
                 // Size of last layer is number of inputs to next layer
                 inputs = _layers.back().size();
+                output = _layers.back().preactivation() + pad(inputs);
             }
 
-            // Zero initialize layer to zero
-            _layers.emplace_back(size, inputs);
+            // Gelu derivative needs the layer input
+            const size_t preactivation = (activation == nnactivation::gelu) ? output + pad(size) : output;
+
+            // Append weight matrix and bias vector to the parameter buffer
+            const size_t weights = _params.size();
+            const size_t bias = weights + pad(size * inputs);
+            _params.resize(bias + pad(size), 0.0);
+            _gradient.resize(_params.size(), 0.0);
+            std::fill(_params.begin() + weights, _params.begin() + weights + size * inputs, 1.0);
+
+            // Grow the shared activation and delta buffers
+            _activation.resize(preactivation + pad(size), 0.0);
+            const size_t width = std::max(_delta.size(), std::max(size, inputs));
+            _delta.resize(width, 0.0);
+            _propagate.resize(width, 0.0);
+
+            // Zero initialize bias to zero
+            _layers.emplace_back(size, inputs, weights, bias, output, preactivation, activation);
         }
         else
         {
@@ -553,78 +896,165 @@ class nnet
         // Initialize dimensions with p1
         nnet<T, IN, OUT> out = p1;
 
-        const auto f = [&p1, &p2](nnode<T> &node, const size_t i, const size_t j) {
-            node *= p2._layers[i][j];
-        };
+        // Breed nets together, average weights and biases
+        const size_t size = out._params.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            out._params[i] = (out._params[i] + p2._params[i]) * 0.5;
 
-        // Breed nets together
-        out.on_net(f);
+            // Check for weight overflow
+            range(out._params[i]);
+        }
 
         return out;
     }
+    inline void backprop(const vector<T, OUT> &set_point, const T step_size = 0.1)
+    {
+        backprop(nullptr, set_point, step_size);
+    }
+    inline void backprop(const std::vector<vector<T, OUT>> &set_point, const T step_size = 0.1)
+    {
+        backprop(nullptr, set_point, step_size);
+    }
     inline void backprop_identity(const vector<T, OUT> &set_point, const T step_size = 0.1)
     {
-        const auto f = [](nnode<T> &node, const T propagated, const T step) {
-            node.backprop_identity(propagated, step);
-        };
-
-        backprop(f, set_point, step_size);
+        backprop(nullptr, set_point, step_size);
+    }
+    inline void backprop_identity(const std::vector<vector<T, OUT>> &set_point, const T step_size = 0.1)
+    {
+        backprop(nullptr, set_point, step_size);
     }
     inline void backprop_relu(const vector<T, OUT> &set_point, const T step_size = 0.1)
     {
-        const auto f = [](nnode<T> &node, const T propagated, const T step) {
-            node.backprop_relu(propagated, step);
-        };
-
-        backprop(f, set_point, step_size);
+        backprop(transfer_deriv_relu, set_point, step_size);
+    }
+    inline void backprop_relu(const std::vector<vector<T, OUT>> &set_point, const T step_size = 0.1)
+    {
+        backprop(transfer_deriv_relu, set_point, step_size);
     }
     inline void backprop_sigmoid(const vector<T, OUT> &set_point, const T step_size = 0.1)
     {
-        const auto f = [](nnode<T> &node, const T propagated, const T step) {
-            node.backprop_sigmoid(propagated, step);
-        };
-
-        backprop(f, set_point, step_size);
+        backprop(transfer_deriv_sigmoid, set_point, step_size);
+    }
+    inline void backprop_sigmoid(const std::vector<vector<T, OUT>> &set_point, const T step_size = 0.1)
+    {
+        backprop(transfer_deriv_sigmoid, set_point, step_size);
     }
     inline void backprop_tanh(const vector<T, OUT> &set_point, const T step_size = 0.1)
     {
-        const auto f = [](nnode<T> &node, const T propagated, const T step) {
-            node.backprop_tanh(propagated, step);
-        };
-
-        backprop(f, set_point, step_size);
+        backprop(transfer_deriv_tanh, set_point, step_size);
+    }
+    inline void backprop_tanh(const std::vector<vector<T, OUT>> &set_point, const T step_size = 0.1)
+    {
+        backprop(transfer_deriv_tanh, set_point, step_size);
+    }
+    inline void hogwild_identity(const std::vector<vector<T, IN>> &input, const std::vector<vector<T, OUT>> &set_point, const T step_size, thread_pool &pool)
+    {
+        hogwild(nullptr, nullptr, input, set_point, step_size, pool);
+    }
+    inline void hogwild_relu(const std::vector<vector<T, IN>> &input, const std::vector<vector<T, OUT>> &set_point, const T step_size, thread_pool &pool)
+    {
+        hogwild(transfer_relu, transfer_deriv_relu, input, set_point, step_size, pool);
+    }
+    inline void hogwild_sigmoid(const std::vector<vector<T, IN>> &input, const std::vector<vector<T, OUT>> &set_point, const T step_size, thread_pool &pool)
+    {
+        hogwild(transfer_sigmoid, transfer_deriv_sigmoid, input, set_point, step_size, pool);
+    }
+    inline void hogwild_tanh(const std::vector<vector<T, IN>> &input, const std::vector<vector<T, OUT>> &set_point, const T step_size, thread_pool &pool)
+    {
+        hogwild(transfer_tanh, transfer_deriv_tanh, input, set_point, step_size, pool);
+    }
+    inline void train_identity(const std::vector<vector<T, IN>> &input, const std::vector<vector<T, OUT>> &set_point, const T step_size, thread_pool &pool)
+    {
+        train(nullptr, nullptr, input, set_point, step_size, pool);
+    }
+    inline void train_relu(const std::vector<vector<T, IN>> &input, const std::vector<vector<T, OUT>> &set_point, const T step_size, thread_pool &pool)
+    {
+        train(transfer_relu, transfer_deriv_relu, input, set_point, step_size, pool);
+    }
+    inline void train_sigmoid(const std::vector<vector<T, IN>> &input, const std::vector<vector<T, OUT>> &set_point, const T step_size, thread_pool &pool)
+    {
+        train(transfer_sigmoid, transfer_deriv_sigmoid, input, set_point, step_size, pool);
+    }
+    inline void train_tanh(const std::vector<vector<T, IN>> &input, const std::vector<vector<T, OUT>> &set_point, const T step_size, thread_pool &pool)
+    {
+        train(transfer_tanh, transfer_deriv_tanh, input, set_point, step_size, pool);
+    }
+    inline vector<T, OUT> calculate() const
+    {
+        return calculate(nullptr);
+    }
+    inline std::vector<vector<T, OUT>> calculate(const std::vector<vector<T, IN>> &input) const
+    {
+        return calculate(nullptr, input);
+    }
+    inline vector<T, OUT> calculate(const vector<T, IN> &input, nnet_workspace<T> &work) const
+    {
+        return calculate(nullptr, input, work);
     }
     inline vector<T, OUT> calculate_identity() const
     {
-        const auto f = [](const nnode<T> &node) {
-            node.calculate_identity();
-        };
-
-        return calculate(f);
+        return calculate(nullptr);
+    }
+    inline std::vector<vector<T, OUT>> calculate_identity(const std::vector<vector<T, IN>> &input) const
+    {
+        return calculate(nullptr, input);
+    }
+    inline vector<T, OUT> calculate_identity(const vector<T, IN> &input, nnet_workspace<T> &work) const
+    {
+        return calculate(nullptr, input, work);
+    }
+    inline std::vector<vector<T, OUT>> calculate_identity(const std::vector<vector<T, IN>> &input, nnet_workspace<T> &work) const
+    {
+        return calculate(nullptr, input, work._input, work._activation);
     }
     inline vector<T, OUT> calculate_relu() const
     {
-        const auto f = [](const nnode<T> &node) {
-            node.calculate_relu();
-        };
-
-        return calculate(f);
+        return calculate(transfer_relu);
+    }
+    inline std::vector<vector<T, OUT>> calculate_relu(const std::vector<vector<T, IN>> &input) const
+    {
+        return calculate(transfer_relu, input);
+    }
+    inline vector<T, OUT> calculate_relu(const vector<T, IN> &input, nnet_workspace<T> &work) const
+    {
+        return calculate(transfer_relu, input, work);
+    }
+    inline std::vector<vector<T, OUT>> calculate_relu(const std::vector<vector<T, IN>> &input, nnet_workspace<T> &work) const
+    {
+        return calculate(transfer_relu, input, work._input, work._activation);
     }
     inline vector<T, OUT> calculate_sigmoid() const
     {
-        const auto f = [](const nnode<T> &node) {
-            node.calculate_sigmoid();
-        };
-
-        return calculate(f);
+        return calculate(transfer_sigmoid);
+    }
+    inline std::vector<vector<T, OUT>> calculate_sigmoid(const std::vector<vector<T, IN>> &input) const
+    {
+        return calculate(transfer_sigmoid, input);
+    }
+    inline vector<T, OUT> calculate_sigmoid(const vector<T, IN> &input, nnet_workspace<T> &work) const
+    {
+        return calculate(transfer_sigmoid, input, work);
+    }
+    inline std::vector<vector<T, OUT>> calculate_sigmoid(const std::vector<vector<T, IN>> &input, nnet_workspace<T> &work) const
+    {
+        return calculate(transfer_sigmoid, input, work._input, work._activation);
     }
     inline vector<T, OUT> calculate_tanh() const
     {
-        const auto f = [](const nnode<T> &node) {
-            node.calculate_tanh();
-        };
-
-        return calculate(f);
+        return calculate(transfer_tanh);
+    }
+    inline std::vector<vector<T, OUT>> calculate_tanh(const std::vector<vector<T, IN>> &input) const
+    {
+        return calculate(transfer_tanh, input);
+    }
+    inline vector<T, OUT> calculate_tanh(const vector<T, IN> &input, nnet_workspace<T> &work) const
+    {
+        return calculate(transfer_tanh, input, work);
+    }
+    inline std::vector<vector<T, OUT>> calculate_tanh(const std::vector<vector<T, IN>> &input, nnet_workspace<T> &work) const
+    {
+        return calculate(transfer_tanh, input, work._input, work._activation);
     }
     inline static bool compatible(const nnet<T, IN, OUT> &p1, const nnet<T, IN, OUT> &p2)
     {
@@ -652,14 +1082,17 @@ class nnet
     {
         return _input;
     }
-    inline const std::vector<T> &get_weights(const size_t i, const size_t j) const
+    inline std::vector<T> get_weights(const size_t i, const size_t j) const
     {
-        return _layers[i][j].get_weights();
+        // Copy row j of the layer weight matrix
+        const nnlayer &layer = _layers[i];
+        const T *const w = &_params[layer.weights() + j * layer.inputs()];
+        return std::vector<T>(w, w + layer.inputs());
     }
     inline void debug_weights(const size_t i, const size_t j) const
     {
-        const size_t size = _layers[i][j].get_inputs();
-        const std::vector<T> &w = _layers[i][j].get_weights();
+        const size_t size = _layers[i].inputs();
+        const std::vector<T> w = get_weights(i, j);
 
         // Print out weights
         for (size_t k = 0; k < size; k++)
@@ -669,7 +1102,7 @@ class nnet
         }
 
         // Print out bias
-        std::cout << "Bias " << _layers[i][j].get_bias() << std::endl;
+        std::cout << "Bias " << _params[_layers[i].bias() + j] << std::endl;
     }
     void debug_connections() const
     {
@@ -686,46 +1119,98 @@ class nnet
     }
     inline T get_output(const size_t i, const size_t j) const
     {
-        return _layers[i][j].output();
+        return _activation[_layers[i].output() + j];
     }
-    inline void finalize()
+    inline void finalize(const unsigned activation = nnactivation::inherit)
     {
         if (!_final)
         {
             // Create output network layer with input count from last layer
-            add_layer(OUT);
+            add_layer(OUT, activation);
             _final = true;
         }
     }
+    // Samples each hogwild thread trains locally before publishing to the shared weights, one publishes every sample
+    inline void set_hogwild_interval(const size_t interval)
+    {
+        if (interval == 0)
+        {
+            throw std::runtime_error("nnet: hogwild interval must be at least one sample");
+        }
+        _interval = interval;
+    }
     inline void set_linear_output(const bool mode)
     {
         _linear_output = mode;
     }
+    inline void set_adam(const T beta1 = 0.9, const T beta2 = 0.999, const T epsilon = 1E-8)
+    {
+        optimizer(_adam, beta1, beta2, epsilon, 0.0);
+    }
+    inline void set_adamw(const T decay, const T beta1 = 0.9, const T beta2 = 0.999, const T epsilon = 1E-8)
+    {
+        optimizer(_adam, beta1, beta2, epsilon, decay);
+    }
+    inline void set_momentum(const T momentum = 0.9, const bool nesterov = false)
+    {
+        optimizer(nesterov ? _nesterov : _momentum, momentum, 0.0, 0.0, 0.0);
+    }
+    inline void set_rmsprop(const T rho = 0.9, const T epsilon = 1E-8)
+    {
+        optimizer(_rmsprop, 0.0, rho, epsilon, 0.0);
+    }
+    inline void set_sgd()
+    {
+        optimizer(_sgd, 0.0, 0.0, 0.0, 0.0);
+    }
     inline void mutate(mml::net_rng<T> &ran)
     {
         // Calculate a random layer index
         const unsigned layer_index = ran.random_int() % _layers.size();
 
         // Calculate a random node index
-        const unsigned node_index = ran.random_int() % _layers[layer_index].size();
+        const nnlayer &layer = _layers[layer_index];
+        const unsigned node_index = ran.random_int() % layer.size();
 
         // Mutate this node
-        _layers[layer_index][node_index].mutate(ran);
+        mutate(&_params[layer.weights() + node_index * layer.inputs()], _params[layer.bias() + node_index], layer.inputs(), ran);
     }
     inline void randomize(mml::net_rng<T> &ran)
     {
-        const auto f = [&ran](nnode<T> &node, const size_t i, const size_t j) {
-            // Randomize weights
-            node.reset(ran);
-        };
+        // For all net layers
+        for (const nnlayer &layer : _layers)
+        {
+            // For all layer nodes, randomize weights then bias
+            const size_t nodes = layer.size();
+            const size_t inputs = layer.inputs();
+            for (size_t j = 0; j < nodes; j++)
+            {
+                T *const w = &_params[layer.weights() + j * inputs];
+                for (size_t k = 0; k < inputs; k++)
+                {
+                    w[k] = ran.random();
+                }
+                _params[layer.bias() + j] = ran.random();
+            }
+        }
 
-        // Randomize the net
-        on_net(f);
+        // Zero out node values
+        std::fill(_activation.begin(), _activation.end(), 0.0);
     }
     inline void reset()
     {
         // Clear layers
         _layers.clear();
+        _params.clear();
+        _activation.clear();
+        _delta.clear();
+        _propagate.clear();
+        _gradient.clear();
+        _workers.clear();
+        _moment.clear();
+        _second.clear();
+        _time = 0;
+        _batch = 0;
 
         // Unfinalize the net
         _final = false;
@@ -744,29 +1229,35 @@ class nnet
         out.push_back(static_cast<T>(_layers.size()));
 
         // Serialize layer sizes
-        const size_t size = _layers.size();
-        for (size_t i = 0; i < size; i++)
+        for (const nnlayer &layer : _layers)
         {
-            const size_t nodes = _layers[i].size();
-            out.push_back(static_cast<T>(nodes));
+            out.push_back(static_cast<T>(layer.size()));
         }
 
-        // Serialize net data
-        const auto f = [&out](const nnode<T> &node, const size_t i, const size_t j) {
-            // Serialize all weights
-            const size_t size = node.get_inputs();
-            const std::vector<T> &weights = node.get_weights();
-            for (size_t k = 0; k < size; k++)
+        // Serialize net data, all weights then bias of each node
+        for (const nnlayer &layer : _layers)
+        {
+            const size_t nodes = layer.size();
+            const size_t inputs = layer.inputs();
+            for (size_t j = 0; j < nodes; j++)
             {
-                out.push_back(weights[k]);
+                const T *const w = &_params[layer.weights() + j * inputs];
+                out.insert(out.end(), w, w + inputs);
+                out.push_back(_params[layer.bias() + j]);
             }
+        }
 
-            // Serialize bias
-            out.push_back(node.get_bias());
-        };
-
-        // Randomize the net
-        on_const_net(f);
+        // Activation code of each layer trails the data, nets that only inherit keep the original format
+        const bool inherit = std::all_of(_layers.begin(), _layers.end(), [](const nnlayer &layer) {
+            return layer.activation() == nnactivation::inherit;
+        });
+        if (!inherit)
+        {
+            for (const nnlayer &layer : _layers)
+            {
+                out.push_back(static_cast<T>(layer.activation()));
+            }
+        }
 
         return out;
     }
@@ -791,8 +1282,12 @@ class nnet
         }
 
         // Clear the layers
-        _layers.clear();
+        reset();
         const int size = static_cast<int>(data[2]);
+        if (size <= 0)
+        {
+            throw std::runtime_error("nnet: can't deserialize, invalid layer count");
+        }
 
         // Check last layer size special case
         const int last = data[2 + size];
@@ -801,9 +1296,9 @@ class nnet
             throw std::runtime_error("nnet: can't deserialize, expected last size '" + std::to_string(OUT) + "' but got '" + std::to_string(last) + "'");
         }
 
-        // Count bytes
+        // Count bytes, bias and inputs per node in each layer
         size_t count = 0;
-        int inputs = 0;
+        size_t inputs = IN;
         for (int i = 0; i < size; i++)
         {
             // Number of nodes in layer
@@ -812,54 +1307,49 @@ class nnet
             {
                 throw std::runtime_error("nnet: invalid layer size");
             }
-
-            // Add new layer
-            this->add_layer(length);
-
-            // Count data members in nodes
-            if (i == 0)
-            {
-                // Bias and one input
-                count += length * (IN + 1);
-                inputs = length;
-            }
-            else
-            {
-                // Bias and inputs per node in layer
-                count += length * (inputs + 1);
-                inputs = length;
-            }
+            count += length * (inputs + 1);
+            inputs = length;
         }
 
-        // Check that the number of nodes makes sense
+        // Check that the number of nodes makes sense, activation codes of each layer may trail the nodes
         const size_t left = data.size() - (size + 3);
-        if (count != left)
+        const bool coded = (left == count + size);
+        if (count != left && !coded)
         {
             throw std::runtime_error("nnet: can't deserialize node mismatch");
         }
 
+        // Add new layers, data without activation codes was written by a net where every layer inherits
+        for (int i = 0; i < size; i++)
+        {
+            unsigned activation = nnactivation::inherit;
+            if (coded)
+            {
+                const T code = data[data.size() - size + i];
+                if (!(code >= 0.0 && code <= nnactivation::gelu) || code != static_cast<unsigned>(code))
+                {
+                    throw std::runtime_error("nnet: can't deserialize, invalid layer activation");
+                }
+                activation = static_cast<unsigned>(code);
+            }
+            this->add_layer(static_cast<size_t>(data[3 + i]), activation);
+        }
+
         // Starting index, assign values to net
         size_t index = 3 + size;
-        const auto f = [&data, &index](nnode<T> &node, const size_t i, const size_t j) {
-            // Create a new node
-            const size_t size = node.get_inputs();
-            node = nnode<T>(size);
-
-            // Copy weights from input stream
-            std::vector<T> &weights = node.get_weights();
-            for (size_t k = 0; k < size; k++)
+        for (const nnlayer &layer : _layers)
+        {
+            // Copy weights then bias of each node from input stream
+            const size_t nodes = layer.size();
+            const size_t inputs = layer.inputs();
+            for (size_t j = 0; j < nodes; j++)
             {
-                weights[k] = data[index];
+                std::copy(&data[index], &data[index] + inputs, &_params[layer.weights() + j * inputs]);
+                index += inputs;
+                _params[layer.bias() + j] = data[index];
                 index++;
             }
-
-            // Set the node bias
-            node.set_bias(data[index]);
-            index++;
-        };
-
-        // Randomize the net
-        on_net(f);
+        }
 
         // Finalize this network
         _final = true;
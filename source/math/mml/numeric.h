@@ -24,6 +24,7 @@ namespace mml
 
 // These classes calculate derivatives with various finite difference methods
 // A custom gradient class can be created by a user that returns analytical derivatives of each function
+// hessian_vector is only needed by equation::min_newton_cg, an analytical or AD class may return exact products
 
 // First order backward finite difference
 template <typename T, size_t N>
@@ -80,6 +81,17 @@ class backward
         // Return hessian matrix of equation
         return hes;
     }
+    inline static vector<T, N> hessian_vector(const equation<T, N, backward> &f, const vector<T, N> &x1, const vector<T, N> &grad, const vector<T, N> &v, const T dx)
+    {
+        // H*v = (grad(x1) - grad(x1 - h*v)) / h, where h*|v| = dx
+        const T h = dx / std::sqrt(v.square_magnitude());
+
+        // Step backward along v
+        const vector<T, N> x0 = x1 - v * h;
+
+        // Evaluate directional derivative of gradient, grad is the gradient at x1
+        return (grad - backward<T, N>::gradient(f, x0, dx)) / h;
+    }
     inline static matrix<T, N, N> jacobian(const equation<T, N, backward> f[N], const vector<T, N> &x1, const T dx)
     {
         // J_ij = df_i/dx_j
@@ -174,6 +186,20 @@ class center
         // return hessian matrix of equation
         return hes;
     }
+    inline static vector<T, N> hessian_vector(const equation<T, N, center> &f, const vector<T, N> &x1, const vector<T, N> &grad, const vector<T, N> &v, const T dx)
+    {
+        // H*v = (grad(x1 + h/2*v) - grad(x1 - h/2*v)) / h, where h*|v| = dx
+        // Centered in x1, so grad at x1 is not used
+        const T h = dx / std::sqrt(v.square_magnitude());
+        const T half_h = h * 0.5;
+
+        // Step backward and forward along v
+        const vector<T, N> x0 = x1 - v * half_h;
+        const vector<T, N> x2 = x1 + v * half_h;
+
+        // Evaluate directional derivative of gradient
+        return (center<T, N>::gradient(f, x2, dx) - center<T, N>::gradient(f, x0, dx)) / h;
+    }
     inline static matrix<T, N, N> jacobian(const equation<T, N, center> f[N], const vector<T, N> &x1, const T dx)
     {
         // J_ij = df_i/dx_j
@@ -252,6 +278,17 @@ class forward
         // return hessian matrix of equation
         return hes;
     }
+    inline static vector<T, N> hessian_vector(const equation<T, N, forward> &f, const vector<T, N> &x1, const vector<T, N> &grad, const vector<T, N> &v, const T dx)
+    {
+        // H*v = (grad(x1 + h*v) - grad(x1)) / h, where h*|v| = dx
+        const T h = dx / std::sqrt(v.square_magnitude());
+
+        // Step forward along v
+        const vector<T, N> x2 = x1 + v * h;
+
+        // Evaluate directional derivative of gradient, grad is the gradient at x1
+        return (forward<T, N>::gradient(f, x2, dx) - grad) / h;
+    }
     inline static matrix<T, N, N> jacobian(const equation<T, N, forward> f[N], const vector<T, N> &x1, const T dx)
     {
         // J_ij = df_i/dx_j
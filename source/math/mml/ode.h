@@ -0,0 +1,741 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __ODE__
+#define __ODE__
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mml/mat.h>
+#include <mml/vec.h>
+#include <stdexcept>
+
+namespace mml
+{
+
+// Right hand side of the system y' = f(t, y)
+template <typename T, size_t N>
+using ode_function = std::function<vector<T, N>(const T, const vector<T, N> &)>;
+
+// Jacobian df/dy of the right hand side
+template <typename T, size_t N>
+using ode_jacobian = std::function<matrix<T, N, N>(const T, const vector<T, N> &)>;
+
+// Root mean square of x / scale, the error norm of all integrators
+template <typename T, size_t N>
+inline T ode_norm(const vector<T, N> &x, const vector<T, N> &scale)
+{
+    T sum = 0.0;
+    for (size_t i = 0; i < N; i++)
+    {
+        const T e = x[i] / scale[i];
+        sum += e * e;
+    }
+
+    return std::sqrt(sum / N);
+}
+
+// Forward difference jacobian of f at (t, y) where fy = f(t, y)
+template <typename T, size_t N>
+inline matrix<T, N, N> ode_difference(const ode_function<T, N> &f, const T t, const vector<T, N> &y, const vector<T, N> &fy)
+{
+    matrix<T, N, N> out;
+    const T root_eps = std::sqrt(std::numeric_limits<T>::epsilon());
+
+    // Perturb one state at a time
+    vector<T, N> yp = y;
+    for (size_t j = 0; j < N; j++)
+    {
+        const T dy = root_eps * std::max(static_cast<T>(1.0), std::abs(y[j]));
+        yp[j] = y[j] + dy;
+        const vector<T, N> fp = f(t, yp);
+        for (size_t i = 0; i < N; i++)
+        {
+            out.get(i, j) = (fp[i] - fy[i]) / dy;
+        }
+        yp[j] = y[j];
+    }
+
+    return out;
+}
+
+// Hairer's initial step size estimate for a method of given order
+template <typename T, size_t N>
+inline T ode_initial_step(const ode_function<T, N> &f, const T t0, const vector<T, N> &y0, const vector<T, N> &f0, const size_t order, const T rtol, const T atol)
+{
+    // Scale of the solution
+    vector<T, N> scale;
+    for (size_t i = 0; i < N; i++)
+    {
+        scale[i] = atol + rtol * std::abs(y0[i]);
+    }
+
+    // First guess from y and f magnitudes
+    const T d0 = ode_norm(y0, scale);
+    const T d1 = ode_norm(f0, scale);
+    const T h0 = (d0 < 1E-5 || d1 < 1E-5) ? 1E-6 : 0.01 * d0 / d1;
+
+    // Estimate the second derivative with an explicit euler step
+    const vector<T, N> y1 = y0 + f0 * h0;
+    const vector<T, N> f1 = f(t0 + h0, y1);
+    const T d2 = ode_norm<T, N>(f1 - f0, scale) / h0;
+
+    T h1;
+    if (d1 <= 1E-15 && d2 <= 1E-15)
+    {
+        h1 = std::max(static_cast<T>(1E-6), h0 * static_cast<T>(1E-3));
+    }
+    else
+    {
+        h1 = std::pow(0.01 / std::max(d1, d2), 1.0 / (order + 1));
+    }
+
+    return std::min(100.0 * h0, h1);
+}
+
+// Adaptive order (1 - 5) backward differentiation formulas in the numerical differentiation form
+// The backward difference array D is rescaled on step size changes, see Shampine and Reichelt
+// The jacobian is only recomputed when the simplified newton iteration fails to converge
+template <typename T, size_t N>
+class bdf
+{
+  private:
+    static constexpr size_t _max_order = 5;
+    static constexpr size_t _newton_iterations = 4;
+    ode_function<T, N> _f;
+    ode_jacobian<T, N> _jac;
+    T _rtol;
+    T _atol;
+    T _max_step;
+
+    // Integrator state
+    T _t;
+    T _t_old;
+    T _h;
+    vector<T, N> _D[_max_order + 3];
+    size_t _order;
+    size_t _equal_steps;
+    matrix<T, N, N> _J;
+    lu_matrix<T, N> _lu;
+    bool _lu_valid;
+    bool _jac_current;
+
+    // Method coefficients
+    T _gamma[_max_order + 1];
+    T _alpha[_max_order + 1];
+    T _error_const[_max_order + 2];
+
+    // Statistics
+    size_t _evaluations;
+    size_t _jacobians;
+    size_t _factorizations;
+    size_t _steps;
+
+    inline static void compute_r(const size_t order, const T factor, T R[_max_order + 1][_max_order + 1])
+    {
+        // R[i][j] = prod_{k=1..i} (k - 1 - factor * j) / k
+        for (size_t j = 0; j <= order; j++)
+        {
+            R[0][j] = 1.0;
+        }
+        for (size_t i = 1; i <= order; i++)
+        {
+            R[i][0] = 0.0;
+            for (size_t j = 1; j <= order; j++)
+            {
+                R[i][j] = R[i - 1][j] * (i - 1.0 - factor * j) / i;
+            }
+        }
+    }
+    inline void change_d(const T factor)
+    {
+        // Rescale differences for a step size ratio of factor, D = (R * U)^T * D
+        T R[_max_order + 1][_max_order + 1];
+        T U[_max_order + 1][_max_order + 1];
+        compute_r(_order, factor, R);
+        compute_r(_order, 1.0, U);
+
+        vector<T, N> D[_max_order + 1];
+        for (size_t i = 0; i <= _order; i++)
+        {
+            for (size_t j = 0; j <= _order; j++)
+            {
+                // RU[j][i]
+                T ru = 0.0;
+                for (size_t k = 0; k <= _order; k++)
+                {
+                    ru += R[j][k] * U[k][i];
+                }
+                D[i] += _D[j] * ru;
+            }
+        }
+        for (size_t i = 0; i <= _order; i++)
+        {
+            _D[i] = D[i];
+        }
+    }
+    inline void jacobian(const T t, const vector<T, N> &y)
+    {
+        if (_jac)
+        {
+            _J = _jac(t, y);
+        }
+        else
+        {
+            _J = ode_difference(_f, t, y, _f(t, y));
+            _evaluations += N + 1;
+        }
+        _jacobians++;
+        _jac_current = true;
+    }
+    inline bool factorize(const T c)
+    {
+        // Factor I - c * J, a singular matrix fails the step
+        matrix<T, N, N> A;
+        for (size_t i = 0; i < N; i++)
+        {
+            for (size_t j = 0; j < N; j++)
+            {
+                A.get(i, j) -= c * _J.get(i, j);
+            }
+        }
+        try
+        {
+            _lu = lu_matrix<T, N>(A);
+            _lu_valid = true;
+        }
+        catch (std::exception &ex)
+        {
+            _lu_valid = false;
+        }
+        _factorizations++;
+
+        return _lu_valid;
+    }
+    // Simplified newton iteration for the implicit formula
+    inline bool newton(const T t_new, const vector<T, N> &y_predict, const T c, const vector<T, N> &psi, const vector<T, N> &scale, vector<T, N> &y, vector<T, N> &d, size_t &iterations)
+    {
+        const T tol = std::max(10.0 * std::numeric_limits<T>::epsilon() / _rtol, std::min(static_cast<T>(0.03), std::sqrt(_rtol)));
+        y = y_predict;
+        d = vector<T, N>();
+        T dy_norm_old = -1.0;
+        for (size_t k = 0; k < _newton_iterations; k++)
+        {
+            iterations = k + 1;
+            const vector<T, N> fy = _f(t_new, y);
+            _evaluations++;
+            const vector<T, N> dy = _lu.solve(fy * c - psi - d);
+            const T dy_norm = ode_norm(dy, scale);
+            if (!std::isfinite(dy_norm))
+            {
+                return false;
+            }
+
+            // Estimate the convergence rate
+            const T rate = (dy_norm_old > 0.0) ? dy_norm / dy_norm_old : -1.0;
+            if (rate >= 1.0 || (rate > 0.0 && std::pow(rate, _newton_iterations - k) / (1.0 - rate) * dy_norm > tol))
+            {
+                return false;
+            }
+
+            y += dy;
+            d += dy;
+            if (dy_norm == 0.0 || (rate > 0.0 && rate / (1.0 - rate) * dy_norm < tol))
+            {
+                return true;
+            }
+            dy_norm_old = dy_norm;
+        }
+
+        return false;
+    }
+
+  public:
+    bdf(const ode_function<T, N> &f, const T t0, const vector<T, N> &y0)
+        : _f(f), _rtol(1E-3), _atol(1E-6), _max_step(std::numeric_limits<T>::max()), _t(t0), _t_old(t0), _h(0.0), _order(1),
+          _equal_steps(0), _lu_valid(false), _jac_current(false), _evaluations(0), _jacobians(0), _factorizations(0), _steps(0)
+    {
+        // Numerical differentiation formula coefficients
+        const T kappa[_max_order + 1] = {0.0, -0.1850, -1.0 / 9.0, -0.0823, -0.0415, 0.0};
+        _gamma[0] = 0.0;
+        for (size_t i = 1; i <= _max_order; i++)
+        {
+            _gamma[i] = _gamma[i - 1] + 1.0 / i;
+        }
+        for (size_t i = 0; i <= _max_order; i++)
+        {
+            _alpha[i] = (1.0 - kappa[i]) * _gamma[i];
+            _error_const[i] = kappa[i] * _gamma[i] + 1.0 / (i + 1.0);
+        }
+        _error_const[_max_order + 1] = 1.0 / (_max_order + 2.0);
+
+        // Store initial state
+        _D[0] = y0;
+    }
+    // Interpolates the solution at t inside the last step
+    inline vector<T, N> dense(const T t) const
+    {
+        if (_steps == 0)
+        {
+            return _D[0];
+        }
+
+        // Polynomial through the backward differences
+        vector<T, N> out = _D[0];
+        T p = 1.0;
+        for (size_t i = 0; i < _order; i++)
+        {
+            p *= (t - (_t - _h * i)) / (_h * (1.0 + i));
+            out += _D[i + 1] * p;
+        }
+
+        return out;
+    }
+    inline size_t get_evaluations() const
+    {
+        return _evaluations;
+    }
+    inline size_t get_factorizations() const
+    {
+        return _factorizations;
+    }
+    inline size_t get_jacobians() const
+    {
+        return _jacobians;
+    }
+    inline size_t get_order() const
+    {
+        return _order;
+    }
+    inline size_t get_steps() const
+    {
+        return _steps;
+    }
+    inline T get_t() const
+    {
+        return _t;
+    }
+    inline const vector<T, N> &get_y() const
+    {
+        return _D[0];
+    }
+    // Steps until t is reached and returns y(t) by dense output, throws if the step size underflows
+    inline vector<T, N> integrate(const T t)
+    {
+        while (_t < t)
+        {
+            if (!step())
+            {
+                throw std::runtime_error("bdf.integrate(): step size too small");
+            }
+        }
+
+        return dense(t);
+    }
+    inline void set_jacobian(const ode_jacobian<T, N> &jac)
+    {
+        _jac = jac;
+    }
+    inline void set_max_step(const T max_step)
+    {
+        _max_step = max_step;
+    }
+    inline void set_tolerance(const T rtol, const T atol)
+    {
+        _rtol = rtol;
+        _atol = atol;
+    }
+    // Takes one step, returns false if the step size became too small
+    inline bool step()
+    {
+        // Initialize step size and differences on the first step
+        if (_h == 0.0)
+        {
+            const vector<T, N> f0 = _f(_t, _D[0]);
+            _evaluations++;
+            _h = std::min(_max_step, ode_initial_step(_f, _t, _D[0], f0, 1, _rtol, _atol));
+            _evaluations++;
+            _D[1] = f0 * _h;
+            jacobian(_t, _D[0]);
+        }
+
+        // Limit the step size
+        const T min_step = 10.0 * std::numeric_limits<T>::epsilon() * std::max(static_cast<T>(1.0), std::abs(_t));
+        if (_h > _max_step)
+        {
+            change_d(_max_step / _h);
+            _h = _max_step;
+            _equal_steps = 0;
+            _lu_valid = false;
+        }
+
+        // The jacobian from a previous step is reused until newton fails
+        _jac_current = false;
+
+        vector<T, N> y_new;
+        vector<T, N> d;
+        vector<T, N> scale;
+        T error_norm = 0.0;
+        T safety = 0.0;
+        while (true)
+        {
+            if (_h < min_step)
+            {
+                return false;
+            }
+            const T t_new = _t + _h;
+
+            // Predict from the differences
+            vector<T, N> y_predict;
+            for (size_t i = 0; i <= _order; i++)
+            {
+                y_predict += _D[i];
+            }
+            for (size_t i = 0; i < N; i++)
+            {
+                scale[i] = _atol + _rtol * std::abs(y_predict[i]);
+            }
+            vector<T, N> psi;
+            for (size_t i = 1; i <= _order; i++)
+            {
+                psi += _D[i] * (_gamma[i] / _alpha[_order]);
+            }
+
+            // Solve the implicit formula, refresh a stale jacobian before shrinking the step
+            const T c = _h / _alpha[_order];
+            bool converged = false;
+            size_t iterations = 0;
+            while (true)
+            {
+                if (!_lu_valid && !factorize(c))
+                {
+                    break;
+                }
+                converged = newton(t_new, y_predict, c, psi, scale, y_new, d, iterations);
+                if (converged || _jac_current)
+                {
+                    break;
+                }
+                jacobian(t_new, y_predict);
+                _lu_valid = false;
+            }
+            if (!converged)
+            {
+                _h *= 0.5;
+                change_d(0.5);
+                _equal_steps = 0;
+                _lu_valid = false;
+                continue;
+            }
+
+            // Estimate the local error
+            safety = 0.9 * (2.0 * _newton_iterations + 1.0) / (2.0 * _newton_iterations + iterations);
+            for (size_t i = 0; i < N; i++)
+            {
+                scale[i] = _atol + _rtol * std::abs(y_new[i]);
+            }
+            error_norm = ode_norm<T, N>(d * _error_const[_order], scale);
+            if (error_norm > 1.0)
+            {
+                // Reject step, the factorization is kept since newton converged
+                const T factor = std::max(static_cast<T>(0.2), safety * std::pow(error_norm, -1.0 / (_order + 1.0)));
+                _h *= factor;
+                change_d(factor);
+                _equal_steps = 0;
+                continue;
+            }
+            break;
+        }
+
+        // Accept step and update differences
+        _steps++;
+        _equal_steps++;
+        _t_old = _t;
+        _t += _h;
+        _D[_order + 2] = d - _D[_order + 1];
+        _D[_order + 1] = d;
+        for (size_t i = _order + 1; i-- > 0;)
+        {
+            _D[i] += _D[i + 1];
+        }
+
+        // Only change step size and order after order + 1 equal steps
+        if (_equal_steps < _order + 1)
+        {
+            return true;
+        }
+
+        // Error estimates at neighbouring orders
+        const T inf = std::numeric_limits<T>::max();
+        const T error_m = (_order > 1) ? ode_norm<T, N>(_D[_order] * _error_const[_order - 1], scale) : inf;
+        const T error_p = (_order < _max_order) ? ode_norm<T, N>(_D[_order + 2] * _error_const[_order + 1], scale) : inf;
+
+        // Pick the order allowing the largest step
+        const T errors[3] = {error_m, error_norm, error_p};
+        T best = 0.0;
+        size_t best_index = 1;
+        for (size_t i = 0; i < 3; i++)
+        {
+            const T f = (errors[i] == inf) ? 0.0 : ((errors[i] > 0.0) ? std::pow(errors[i], -1.0 / (_order + i)) : inf);
+            if (f > best)
+            {
+                best = f;
+                best_index = i;
+            }
+        }
+        _order = _order + best_index - 1;
+
+        // Change step size
+        const T factor = std::min(static_cast<T>(10.0), safety * best);
+        _h *= factor;
+        change_d(factor);
+        _equal_steps = 0;
+        _lu_valid = false;
+
+        return true;
+    }
+};
+
+// Rosenbrock-W method of order 2(3) from Shampine and Reichelt's ode23s
+// Being a W-method the jacobian may be stale, it is only refreshed when a step is rejected
+// The factorization of W = I - h * d * J is reused while the step size stays in a dead band
+template <typename T, size_t N>
+class rosenbrock
+{
+  private:
+    ode_function<T, N> _f;
+    ode_jacobian<T, N> _jac;
+    T _rtol;
+    T _atol;
+    T _max_step;
+
+    // Integrator state
+    T _t;
+    T _t_old;
+    T _h;
+    T _h_old;
+    T _h_lu;
+    vector<T, N> _y;
+    vector<T, N> _y_old;
+    vector<T, N> _f0;
+    vector<T, N> _dfdt;
+    vector<T, N> _k1;
+    vector<T, N> _k2;
+    matrix<T, N, N> _J;
+    lu_matrix<T, N> _lu;
+    bool _jac_current;
+
+    // Statistics
+    size_t _evaluations;
+    size_t _jacobians;
+    size_t _factorizations;
+    size_t _steps;
+
+    inline void jacobian()
+    {
+        // Jacobian at the current point
+        if (_jac)
+        {
+            _J = _jac(_t, _y);
+        }
+        else
+        {
+            _J = ode_difference(_f, _t, _y, _f0);
+            _evaluations += N;
+        }
+        _jacobians++;
+        _jac_current = true;
+        _h_lu = 0.0;
+    }
+
+  public:
+    rosenbrock(const ode_function<T, N> &f, const T t0, const vector<T, N> &y0)
+        : _f(f), _rtol(1E-3), _atol(1E-6), _max_step(std::numeric_limits<T>::max()), _t(t0), _t_old(t0), _h(0.0), _h_old(0.0), _h_lu(0.0),
+          _y(y0), _y_old(y0), _jac_current(false), _evaluations(0), _jacobians(0), _factorizations(0), _steps(0) {}
+    // Interpolates the solution at t inside the last step
+    inline vector<T, N> dense(const T t) const
+    {
+        if (_steps == 0)
+        {
+            return _y;
+        }
+
+        // Quadratic through the last step
+        const T d = 1.0 / (2.0 + std::sqrt(2.0));
+        const T s = (t - _t_old) / _h_old;
+        return _y_old + (_k1 * (s * (1.0 - s) / (1.0 - 2.0 * d)) + _k2 * (s * (s - 2.0 * d) / (1.0 - 2.0 * d))) * _h_old;
+    }
+    inline size_t get_evaluations() const
+    {
+        return _evaluations;
+    }
+    inline size_t get_factorizations() const
+    {
+        return _factorizations;
+    }
+    inline size_t get_jacobians() const
+    {
+        return _jacobians;
+    }
+    inline size_t get_steps() const
+    {
+        return _steps;
+    }
+    inline T get_t() const
+    {
+        return _t;
+    }
+    inline const vector<T, N> &get_y() const
+    {
+        return _y;
+    }
+    // Steps until t is reached and returns y(t) by dense output, throws if the step size underflows
+    inline vector<T, N> integrate(const T t)
+    {
+        while (_t < t)
+        {
+            if (!step())
+            {
+                throw std::runtime_error("rosenbrock.integrate(): step size too small");
+            }
+        }
+
+        return dense(t);
+    }
+    inline void set_jacobian(const ode_jacobian<T, N> &jac)
+    {
+        _jac = jac;
+    }
+    inline void set_max_step(const T max_step)
+    {
+        _max_step = max_step;
+    }
+    inline void set_tolerance(const T rtol, const T atol)
+    {
+        _rtol = rtol;
+        _atol = atol;
+    }
+    // Takes one step, returns false if the step size became too small
+    inline bool step()
+    {
+        const T d = 1.0 / (2.0 + std::sqrt(2.0));
+        const T e32 = 6.0 + std::sqrt(2.0);
+
+        // Initialize step size on the first step
+        if (_h == 0.0)
+        {
+            _f0 = _f(_t, _y);
+            _evaluations++;
+            _h = std::min(_max_step, ode_initial_step(_f, _t, _y, _f0, 2, _rtol, _atol));
+            _evaluations++;
+            jacobian();
+        }
+        const T min_step = 10.0 * std::numeric_limits<T>::epsilon() * std::max(static_cast<T>(1.0), std::abs(_t));
+        _h = std::min(_h, _max_step);
+
+        // The time derivative is cheap and must be current for non-autonomous problems
+        const T dt = std::sqrt(std::numeric_limits<T>::epsilon()) * std::max(std::abs(_t), _h);
+        _dfdt = (_f(_t + dt, _y) - _f0) * (1.0 / dt);
+        _evaluations++;
+
+        while (true)
+        {
+            if (_h < min_step)
+            {
+                return false;
+            }
+
+            // Factor W = I - h * d * J if the step size changed
+            if (_h != _h_lu)
+            {
+                matrix<T, N, N> W;
+                for (size_t i = 0; i < N; i++)
+                {
+                    for (size_t j = 0; j < N; j++)
+                    {
+                        W.get(i, j) -= _h * d * _J.get(i, j);
+                    }
+                }
+                _factorizations++;
+                try
+                {
+                    _lu = lu_matrix<T, N>(W);
+                    _h_lu = _h;
+                }
+                catch (std::exception &ex)
+                {
+                    _h *= 0.5;
+                    _h_lu = 0.0;
+                    continue;
+                }
+            }
+
+            // Stages
+            const vector<T, N> hdt = _dfdt * (_h * d);
+            const vector<T, N> k1 = _lu.solve(_f0 + hdt);
+            const vector<T, N> f1 = _f(_t + 0.5 * _h, _y + k1 * (0.5 * _h));
+            const vector<T, N> k2 = _lu.solve(f1 - k1) + k1;
+            const vector<T, N> y_new = _y + k2 * _h;
+            const vector<T, N> f2 = _f(_t + _h, y_new);
+            const vector<T, N> k3 = _lu.solve(f2 - (k2 - f1) * e32 - (k1 - _f0) * 2.0 + hdt);
+            _evaluations += 2;
+
+            // Estimate the local error
+            vector<T, N> scale;
+            for (size_t i = 0; i < N; i++)
+            {
+                scale[i] = _atol + _rtol * std::max(std::abs(_y[i]), std::abs(y_new[i]));
+            }
+            const T error_norm = ode_norm<T, N>((k1 - k2 * 2.0 + k3) * (_h / 6.0), scale);
+            if (!(error_norm <= 1.0))
+            {
+                // Refresh a stale jacobian before shrinking the step
+                if (!_jac_current)
+                {
+                    jacobian();
+                    continue;
+                }
+                const T factor = (std::isfinite(error_norm)) ? std::max(static_cast<T>(0.2), static_cast<T>(0.9 * std::pow(error_norm, -1.0 / 3.0))) : 0.2;
+                _h *= factor;
+                continue;
+            }
+
+            // Accept step, the last stage is the first stage of the next step
+            _steps++;
+            _t_old = _t;
+            _y_old = _y;
+            _h_old = _h;
+            _k1 = k1;
+            _k2 = k2;
+            _t += _h;
+            _y = y_new;
+            _f0 = f2;
+            _jac_current = false;
+
+            // Keep the step size, and the factorization, unless the change is significant
+            const T factor = (error_norm > 0.0) ? std::min(static_cast<T>(5.0), static_cast<T>(0.9 * std::pow(error_norm, -1.0 / 3.0))) : 5.0;
+            if (factor < 1.0 || factor > 1.2)
+            {
+                _h *= factor;
+            }
+
+            return true;
+        }
+    }
+};
+} // namespace mml
+
+#endif
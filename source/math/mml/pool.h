@@ -0,0 +1,244 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __THREAD_POOL__
+#define __THREAD_POOL__
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mml
+{
+
+// Persistent worker threads for running independent work items
+// The calling thread also works, so a pool of 'threads' creates 'threads - 1' workers
+// A pool of zero or one threads runs all work on the calling thread
+// Work is split evenly between threads, idle threads steal half of the remaining work from busy threads
+class thread_pool
+{
+  private:
+    // Range of work items owned by one thread, protected by its own lock
+    struct work_range
+    {
+        std::mutex lock;
+        size_t begin;
+        size_t end;
+        work_range() : begin(0), end(0) {}
+    };
+    std::vector<std::thread> _workers;
+    std::vector<work_range> _ranges;
+    std::mutex _mutex;
+    std::condition_variable _start;
+    std::condition_variable _finish;
+    const std::function<void(const size_t)> *_work;
+    std::exception_ptr _error;
+    size_t _busy;
+    size_t _epoch;
+    bool _exit;
+
+    inline bool pop(const size_t id, size_t &item)
+    {
+        // Take the next item from the front of our own range
+        work_range &own = _ranges[id];
+        std::lock_guard<std::mutex> lock(own.lock);
+        if (own.begin < own.end)
+        {
+            item = own.begin++;
+            return true;
+        }
+
+        return false;
+    }
+    inline bool steal(const size_t id, size_t &item)
+    {
+        // Visit other threads starting with our neighbor
+        const size_t size = _ranges.size();
+        for (size_t i = 1; i < size; i++)
+        {
+            work_range &victim = _ranges[(id + i) % size];
+            size_t begin = 0;
+            size_t end = 0;
+            {
+                // Steal the back half of the victims range
+                std::lock_guard<std::mutex> lock(victim.lock);
+                const size_t remain = victim.end - victim.begin;
+                if (remain == 0)
+                {
+                    continue;
+                }
+                begin = victim.end - (remain + 1) / 2;
+                end = victim.end;
+                victim.end = begin;
+            }
+
+            // Keep the first stolen item, store the rest in our range
+            item = begin;
+            work_range &own = _ranges[id];
+            std::lock_guard<std::mutex> lock(own.lock);
+            own.begin = begin + 1;
+            own.end = end;
+
+            return true;
+        }
+
+        return false;
+    }
+    inline void consume(const size_t id)
+    {
+        // Do own work first, then steal work until all ranges are empty
+        const std::function<void(const size_t)> &work = *_work;
+        try
+        {
+            size_t item = 0;
+            while (pop(id, item) || steal(id, item))
+            {
+                work(item);
+            }
+        }
+        catch (...)
+        {
+            // Store the first error
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_error)
+                {
+                    _error = std::current_exception();
+                }
+            }
+
+            // Skip remaining work
+            for (work_range &r : _ranges)
+            {
+                std::lock_guard<std::mutex> lock(r.lock);
+                r.begin = r.end;
+            }
+        }
+    }
+    inline void worker(const size_t id)
+    {
+        size_t epoch = 0;
+        while (true)
+        {
+            // Wait for new work or exit signal
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _start.wait(lock, [this, &epoch]() { return _exit || _epoch != epoch; });
+                if (_exit)
+                {
+                    return;
+                }
+                epoch = _epoch;
+            }
+
+            // Do work
+            consume(id);
+
+            // Signal this worker is finished
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _busy--;
+                if (_busy == 0)
+                {
+                    _finish.notify_one();
+                }
+            }
+        }
+    }
+
+  public:
+    thread_pool(const size_t threads = std::thread::hardware_concurrency())
+        : _ranges(std::max(threads, static_cast<size_t>(1))), _work(nullptr), _busy(0), _epoch(0), _exit(false)
+    {
+        // Create workers, calling thread is the last worker
+        for (size_t i = 1; i < threads; i++)
+        {
+            _workers.emplace_back(&thread_pool::worker, this, i - 1);
+        }
+    }
+    ~thread_pool()
+    {
+        // Signal all workers to exit
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _exit = true;
+        }
+        _start.notify_all();
+
+        // Wait for all workers to exit
+        for (std::thread &t : _workers)
+        {
+            t.join();
+        }
+    }
+    inline size_t get_threads() const
+    {
+        return _workers.size() + 1;
+    }
+    // Calls work(i) for all i in range [0, size) and blocks until all are finished
+    // Work items may run concurrently and in any order, run is not reentrant
+    // If any work item throws, the first exception is rethrown here
+    inline void run(const size_t size, const std::function<void(const size_t)> &work)
+    {
+        // Run serially if no workers or nothing to share
+        if (_workers.size() == 0 || size < 2)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                work(i);
+            }
+
+            return;
+        }
+
+        // Split work evenly between all threads
+        const size_t threads = _ranges.size();
+        for (size_t i = 0; i < threads; i++)
+        {
+            std::lock_guard<std::mutex> lock(_ranges[i].lock);
+            _ranges[i].begin = (size * i) / threads;
+            _ranges[i].end = (size * (i + 1)) / threads;
+        }
+
+        // Publish work to the workers
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _work = &work;
+            _error = nullptr;
+            _busy = _workers.size();
+            _epoch++;
+        }
+        _start.notify_all();
+
+        // Calling thread also does work
+        consume(threads - 1);
+
+        // Wait for all workers to finish
+        std::unique_lock<std::mutex> lock(_mutex);
+        _finish.wait(lock, [this]() { return _busy == 0; });
+
+        // Rethrow any work errors
+        if (_error)
+        {
+            std::rethrow_exception(_error);
+        }
+    }
+};
+} // namespace mml
+
+#endif
@@ -0,0 +1,261 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __STATIC_NEURAL_NET__
+#define __STATIC_NEURAL_NET__
+
+#include <array>
+#include <mml/activation.h>
+#include <mml/vec.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace mml
+{
+
+// Layers of a static_nnet, layer of N nodes reads IN inputs and feeds the layers S
+// Every loop bound is a template parameter so the whole net unrolls at compile time
+template <typename T, size_t IN, size_t... S>
+class static_nnlayer;
+
+template <typename T, size_t IN>
+class static_nnlayer<T, IN>
+{
+  public:
+    static constexpr size_t layers = 0;
+    static constexpr size_t out = IN;
+
+    template <typename F>
+    inline void calculate(const T *x, T *output, const bool) const
+    {
+        for (size_t i = 0; i < IN; i++)
+        {
+            output[i] = x[i];
+        }
+    }
+    inline void deserialize(const std::vector<T> &, size_t &) {}
+    inline void serialize(std::vector<T> &) const {}
+    inline void sizes(std::vector<T> &) const {}
+};
+
+template <typename T, size_t IN, size_t N, size_t... S>
+class static_nnlayer<T, IN, N, S...>
+{
+  private:
+    std::array<T, N * IN> _weights;
+    std::array<T, N> _bias;
+    static_nnlayer<T, N, S...> _next;
+
+  public:
+    static constexpr size_t layers = 1 + sizeof...(S);
+    static constexpr size_t out = static_nnlayer<T, N, S...>::out;
+
+    static_nnlayer() : _weights(), _bias() {}
+    template <typename F>
+    inline void calculate(const T *x, T *output, const bool linear) const
+    {
+        // Weight matrix times activation vector of previous layer
+        T y[N];
+        for (size_t i = 0; i < N; i++)
+        {
+            const T *const w = &_weights[i * IN];
+            T sum = _bias[i];
+            for (size_t j = 0; j < IN; j++)
+            {
+                sum += w[j] * x[j];
+            }
+            y[i] = sum;
+        }
+
+        // Activate each node, unless this is a linear output layer
+        if (layers > 1 || !linear)
+        {
+            for (size_t i = 0; i < N; i++)
+            {
+                y[i] = F::transfer(y[i]);
+            }
+        }
+
+        _next.template calculate<F>(y, output, linear);
+    }
+    inline void deserialize(const std::vector<T> &data, size_t &index)
+    {
+        // Weights then bias of each node
+        for (size_t i = 0; i < N; i++)
+        {
+            for (size_t j = 0; j < IN; j++)
+            {
+                _weights[i * IN + j] = data[index++];
+            }
+            _bias[i] = data[index++];
+        }
+        _next.deserialize(data, index);
+    }
+    inline void serialize(std::vector<T> &out) const
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            out.insert(out.end(), &_weights[i * IN], &_weights[i * IN] + IN);
+            out.push_back(_bias[i]);
+        }
+        _next.serialize(out);
+    }
+    inline void sizes(std::vector<T> &out) const
+    {
+        out.push_back(static_cast<T>(N));
+        _next.sizes(out);
+    }
+};
+
+// Feed forward net with topology IN -> S... fixed at compile time, the last size in S is the output size
+// A single size in S is a net without hidden layers
+// Weights live in std::array members, calculate does no allocation and has no data dependent branches
+// Loads and stores the nnet serialize format, so a net trained with nnet can be evaluated here
+// The transfer function is shared by all layers as in the nnet calculate_* calls, nets with per layer activations are rejected
+template <typename T, size_t IN, size_t... S>
+class static_nnet
+{
+    static_assert(sizeof...(S) >= 1, "static_nnet: needs an output layer");
+
+  public:
+    static constexpr size_t OUT = static_nnlayer<T, IN, S...>::out;
+
+  private:
+    struct identity
+    {
+        inline static T transfer(const T x)
+        {
+            return x;
+        }
+    };
+    struct relu
+    {
+        // Softplus, same as nnet calculate_relu
+        inline static T transfer(const T x)
+        {
+            return act_softplus<T>(x);
+        }
+    };
+    struct sigmoid
+    {
+        inline static T transfer(const T x)
+        {
+            return act_sigmoid<T>(x);
+        }
+    };
+    struct tanh
+    {
+        inline static T transfer(const T x)
+        {
+            return act_tanh<T>(x);
+        }
+    };
+    static_nnlayer<T, IN, S...> _layers;
+    bool _linear_output;
+
+    template <typename F>
+    inline vector<T, OUT> calculate(const vector<T, IN> &input) const
+    {
+        T x[IN];
+        for (size_t i = 0; i < IN; i++)
+        {
+            x[i] = input[i];
+        }
+
+        // Propagate input through all layers
+        T y[OUT];
+        _layers.template calculate<F>(x, y, _linear_output);
+
+        return vector<T, OUT>(y);
+    }
+
+  public:
+    static_nnet() : _linear_output(false) {}
+    static_nnet(const std::vector<T> &data) : _linear_output(false)
+    {
+        deserialize(data);
+    }
+    inline vector<T, OUT> calculate_identity(const vector<T, IN> &input) const
+    {
+        return calculate<identity>(input);
+    }
+    inline vector<T, OUT> calculate_relu(const vector<T, IN> &input) const
+    {
+        return calculate<relu>(input);
+    }
+    inline vector<T, OUT> calculate_sigmoid(const vector<T, IN> &input) const
+    {
+        return calculate<sigmoid>(input);
+    }
+    inline vector<T, OUT> calculate_tanh(const vector<T, IN> &input) const
+    {
+        return calculate<tanh>(input);
+    }
+    inline void set_linear_output(const bool mode)
+    {
+        _linear_output = mode;
+    }
+    inline std::vector<T> serialize() const
+    {
+        // Same layout as nnet, dimensions, layer sizes then weights and bias of each node
+        std::vector<T> out;
+        out.push_back(static_cast<T>(IN));
+        out.push_back(static_cast<T>(OUT));
+        out.push_back(static_cast<T>(sizeof...(S)));
+        _layers.sizes(out);
+        _layers.serialize(out);
+
+        return out;
+    }
+    inline void deserialize(const std::vector<T> &data)
+    {
+        // Check the header against the compile time topology
+        std::vector<T> header;
+        header.push_back(static_cast<T>(IN));
+        header.push_back(static_cast<T>(OUT));
+        header.push_back(static_cast<T>(sizeof...(S)));
+        _layers.sizes(header);
+        if (data.size() < header.size())
+        {
+            throw std::runtime_error("static_nnet: can't deserialize, not enough data");
+        }
+        for (size_t i = 0; i < header.size(); i++)
+        {
+            if (static_cast<int>(data[i]) != static_cast<int>(header[i]))
+            {
+                throw std::runtime_error("static_nnet: can't deserialize, expected '" + std::to_string(static_cast<int>(header[i])) + "' but got '" + std::to_string(static_cast<int>(data[i])) + "' at " + std::to_string(i));
+            }
+        }
+
+        // Check that the number of nodes makes sense, nnet appends activation codes if any layer has its own activation
+        std::vector<T> weights;
+        _layers.serialize(weights);
+        if (data.size() == header.size() + weights.size() + sizeof...(S))
+        {
+            throw std::runtime_error("static_nnet: can't deserialize per layer activations");
+        }
+        else if (data.size() != header.size() + weights.size())
+        {
+            throw std::runtime_error("static_nnet: can't deserialize node mismatch");
+        }
+
+        // Assign values to net
+        size_t index = header.size();
+        _layers.deserialize(data, index);
+    }
+};
+} // namespace mml
+
+#endif
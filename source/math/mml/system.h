@@ -15,9 +15,15 @@ limitations under the License.
 #ifndef __SYSTEM__
 #define __SYSTEM__
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <mml/equation.h>
+#include <mml/mat.h>
+#include <mml/mult.h>
 #include <mml/numeric.h>
 #include <mml/vec.h>
+#include <stdexcept>
 
 namespace mml
 {
@@ -26,13 +32,198 @@ template <typename T, size_t N, template <typename, size_t> class numeric>
 class system
 {
   private:
+    static constexpr unsigned _newton = 0;
+    static constexpr unsigned _line_search = 1;
+    static constexpr unsigned _dogleg = 2;
     equation<T, N, numeric> _system[N];
     size_t _max_iterations;
     T _tolerance;
+    unsigned _mode;
+
+    // Newton direction, falls back to steepest descent of 1/2 |F|^2 if the jacobian is singular
+    inline vector<T, N> direction(const matrix<T, N, N> &jac, const vector<T, N> &y, const vector<T, N> &grad, bool &newton) const
+    {
+        try
+        {
+            newton = true;
+            return jac.ludecomp(y) * -1.0;
+        }
+        catch (std::exception &ex)
+        {
+            newton = false;
+            return grad * -1.0;
+        }
+    }
+    // Backtracking line search on 1/2 |F|^2
+    inline T line_search(const vector<T, N> &x0, vector<T, N> &x1) const
+    {
+        // Start searching for all equations = 0
+        x1 = x0;
+        vector<T, N> y = this->evaluate(x1);
+        T convergence = y.square_magnitude();
+
+        // Search for up to _max_iterations
+        for (size_t i = 0; i < _max_iterations; i++)
+        {
+            // Determine if we have converged
+            if (convergence < _tolerance)
+            {
+                return convergence;
+            }
+
+            // Calculate the search direction
+            const matrix<T, N, N> jac = this->jacobian(x1, _tolerance);
+            const vector<T, N> grad = multiply<T, N, N>(jac.transpose(), y);
+            bool newton;
+            const vector<T, N> p = direction(jac, y, grad, newton);
+
+            // Slope of the merit function along p, -|F|^2 for the newton step
+            const T phi = 0.5 * convergence;
+            const T slope = grad.dot(p);
+            if (slope >= 0.0)
+            {
+                return convergence;
+            }
+
+            // Backtrack until the armijo condition holds
+            T t = 1.0;
+            vector<T, N> xt = x1 + p;
+            vector<T, N> yt = this->evaluate(xt);
+            T phi_t = 0.5 * yt.square_magnitude();
+            while (phi_t > phi + 1E-4 * t * slope && t > 1E-10)
+            {
+                // Minimize quadratic interpolant, keep within [0.1t, 0.5t]
+                const T tq = -slope * t * t / (2.0 * (phi_t - phi - slope * t));
+                t = std::min(std::max(tq, 0.1 * t), 0.5 * t);
+                xt = x1 + p * t;
+                yt = this->evaluate(xt);
+                phi_t = 0.5 * yt.square_magnitude();
+            }
+
+            // Accept the step, its residual is reused next iteration
+            x1 = xt;
+            y = yt;
+            convergence = 2.0 * phi_t;
+        }
+
+        // Return the sums square of the residuals, should be close to zero at solution
+        return convergence;
+    }
+    // Powell's dogleg trust region on 1/2 |F|^2
+    inline T dogleg(const vector<T, N> &x0, vector<T, N> &x1) const
+    {
+        // Start searching for all equations = 0
+        x1 = x0;
+        vector<T, N> y = this->evaluate(x1);
+        T convergence = y.square_magnitude();
+
+        // Initial trust region radius
+        T delta = std::max(1.0, std::sqrt(x0.square_magnitude()));
+
+        // The jacobian is only recomputed after an accepted step
+        bool accepted = true;
+        matrix<T, N, N> jac;
+        vector<T, N> grad;
+        vector<T, N> pn;
+        vector<T, N> pc;
+        bool newton = false;
+
+        // Search for up to _max_iterations
+        for (size_t i = 0; i < _max_iterations; i++)
+        {
+            // Determine if we have converged
+            if (convergence < _tolerance)
+            {
+                return convergence;
+            }
+
+            if (accepted)
+            {
+                // Gradient of the merit function
+                jac = this->jacobian(x1, _tolerance);
+                grad = multiply<T, N, N>(jac.transpose(), y);
+
+                // Newton and cauchy steps
+                pn = direction(jac, y, grad, newton);
+                const T jg = multiply<T, N, N>(jac, grad).square_magnitude();
+                if (jg <= 0.0)
+                {
+                    return convergence;
+                }
+                pc = grad * (-grad.square_magnitude() / jg);
+            }
+
+            // Choose a step on the dogleg path
+            const T delta2 = delta * delta;
+            vector<T, N> p;
+            if (newton && pn.square_magnitude() <= delta2)
+            {
+                // Full newton step is inside the trust region
+                p = pn;
+            }
+            else if (pc.square_magnitude() >= delta2)
+            {
+                // Cauchy point is outside the trust region, step to the boundary
+                p = pc * (delta / std::sqrt(pc.square_magnitude()));
+            }
+            else if (!newton)
+            {
+                // Singular jacobian, no newton point to step toward so take the cauchy point
+                p = pc;
+            }
+            else
+            {
+                // Intersect the segment from cauchy point to newton point with the boundary
+                const vector<T, N> d = pn - pc;
+                const T a = d.square_magnitude();
+                const T b = 2.0 * pc.dot(d);
+                const T c = pc.square_magnitude() - delta2;
+                const T tau = (-b + std::sqrt(b * b - 4.0 * a * c)) / (2.0 * a);
+                p = pc + d * tau;
+            }
+
+            // Predicted reduction of the linear model
+            const T phi = 0.5 * convergence;
+            const T predicted = phi - 0.5 * (y + multiply<T, N, N>(jac, p)).square_magnitude();
+
+            // Actual reduction
+            const vector<T, N> xt = x1 + p;
+            const vector<T, N> yt = this->evaluate(xt);
+            const T phi_t = 0.5 * yt.square_magnitude();
+            const T rho = (predicted > 0.0) ? (phi - phi_t) / predicted : -1.0;
+
+            // Update the trust region radius
+            const T p_norm = std::sqrt(p.square_magnitude());
+            if (rho < 0.25)
+            {
+                delta = 0.25 * p_norm;
+            }
+            else if (rho > 0.75 && p_norm > 0.99 * delta)
+            {
+                delta = 2.0 * delta;
+            }
+
+            // Accept the step if it reduces the merit function, reuse its residual
+            accepted = rho > 1E-4;
+            if (accepted)
+            {
+                x1 = xt;
+                y = yt;
+                convergence = 2.0 * phi_t;
+            }
+            else if (delta < std::numeric_limits<T>::epsilon())
+            {
+                return convergence;
+            }
+        }
+
+        // Return the sums square of the residuals, should be close to zero at solution
+        return convergence;
+    }
 
   public:
     system(const equation<T, N, numeric> eqs[N])
-        : _max_iterations(100), _tolerance(1E-4)
+        : _max_iterations(100), _tolerance(1E-4), _mode(_newton)
     {
         // Copy all functions
         for (size_t i = 0; i < N; i++)
@@ -57,9 +248,39 @@ class system
 
         return out;
     }
+    inline void set_dogleg()
+    {
+        _mode = _dogleg;
+    }
+    inline void set_line_search()
+    {
+        _mode = _line_search;
+    }
+    inline void set_max_iterations(const size_t iterations)
+    {
+        _max_iterations = iterations;
+    }
+    inline void set_newton()
+    {
+        _mode = _newton;
+    }
+    inline void set_tolerance(const T tolerance)
+    {
+        _tolerance = tolerance;
+    }
     // Uses Newton's Method to find roots of the system of equations
+    // Full newton steps by default, set_line_search() or set_dogleg() globalize the iteration
     inline T zero(const vector<T, N> &x0, vector<T, N> &x1) const
     {
+        if (_mode == _line_search)
+        {
+            return line_search(x0, x1);
+        }
+        else if (_mode == _dogleg)
+        {
+            return dogleg(x0, x1);
+        }
+
         // Start searching for all equations = 0
         x1 = x0;
 
@@ -127,6 +127,19 @@ class vector
             _vec[i] /= vec[i];
         }
     }
+    inline T dot(const vector<T, N> &vec) const
+    {
+        T out = 0.0;
+
+        // Calculate the dot product of the vectors
+        for (size_t i = 0; i < N; i++)
+        {
+            out += _vec[i] * vec[i];
+        }
+
+        // Return the dot product
+        return out;
+    }
     inline T square_magnitude() const
     {
         T out = 0.0;
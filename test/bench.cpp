@@ -0,0 +1,99 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <mml/nnet.h>
+#include <mml/pool.h>
+#include <thread>
+#include <vector>
+
+// Samples per second of a training function over one epoch
+template <typename F>
+double samples_per_second(F f, const size_t samples, const size_t epochs)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < epochs; i++)
+    {
+        f();
+    }
+    const std::chrono::duration<double> diff = std::chrono::steady_clock::now() - start;
+    return (samples * epochs) / diff.count();
+}
+
+int main()
+{
+    try
+    {
+        // Sigmoid net with two wide hidden layers
+        mml::net_rng<double> rng;
+        mml::nnet<double, 64, 8> base;
+        base.add_layer(256);
+        base.add_layer(256);
+        base.finalize();
+        base.randomize(rng);
+
+        // Training set
+        const size_t samples = 4096;
+        const size_t epochs = 4;
+        std::vector<mml::vector<double, 64>> in(samples);
+        std::vector<mml::vector<double, 8>> sp(samples);
+        for (size_t s = 0; s < samples; s++)
+        {
+            for (size_t i = 0; i < 64; i++)
+            {
+                in[s][i] = std::sin(0.1 * (s + i));
+            }
+            for (size_t i = 0; i < 8; i++)
+            {
+                sp[s][i] = 0.5 + 0.4 * std::cos(0.3 * (s + i));
+            }
+        }
+
+        // Single threaded backprop_sigmoid baseline
+        mml::nnet<double, 64, 8> serial = base;
+        const auto sequential = [&serial, &in, &sp, samples]() {
+            for (size_t s = 0; s < samples; s++)
+            {
+                serial.set_input(in[s]);
+                serial.calculate_sigmoid();
+                serial.backprop_sigmoid(sp[s], 0.01);
+            }
+        };
+        const double single = samples_per_second(sequential, samples, epochs);
+        std::cout << "backprop_sigmoid: " << single << " samples/s" << std::endl;
+
+        // Hogwild training on a shared net with increasing thread count
+        const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+        for (size_t threads = 1; threads <= 2 * cores; threads *= 2)
+        {
+            mml::nnet<double, 64, 8> net = base;
+            mml::thread_pool pool(threads);
+            const auto hogwild = [&net, &in, &sp, &pool]() {
+                net.hogwild_sigmoid(in, sp, 0.01, pool);
+            };
+            const double rate = samples_per_second(hogwild, samples, epochs);
+            std::cout << "hogwild_sigmoid " << threads << " threads: " << rate << " samples/s, speedup " << rate / single << std::endl;
+        }
+    }
+    catch (std::exception &ex)
+    {
+        std::cout << ex.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
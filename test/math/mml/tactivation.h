@@ -0,0 +1,87 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __TESTACTIVATION__
+#define __TESTACTIVATION__
+
+#include <algorithm>
+#include <cmath>
+#include <mml/activation.h>
+#include <mml/test.h>
+#include <vector>
+
+bool test_activation()
+{
+    bool out = true;
+
+    // Test relative error of exp over the whole clamped range
+    {
+        double error = 0.0;
+        for (int i = -6900; i <= 6900; i++)
+        {
+            const double x = 0.1013 * i;
+            const double e = std::exp(x);
+            error = std::max(error, std::abs(mml::act_exp<double>(x) - e) / e);
+        }
+        out = out && test(0.0, error, 1E-13, "Failed activation exp double");
+
+        float errorf = 0.0;
+        for (int i = -800; i <= 800; i++)
+        {
+            const float x = 0.1013f * i;
+            const float e = std::exp(x);
+            errorf = std::max(errorf, std::abs(mml::act_exp<float>(x) - e) / e);
+        }
+        out = out && test(0.0f, errorf, 1E-6f, "Failed activation exp float");
+    }
+
+    // Test absolute error of the bounded activations on a whole buffer
+    {
+        const size_t size = 4001;
+        std::vector<double> x(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            x[i] = -40.0 + 0.02 * i;
+        }
+        std::vector<double> sig = x;
+        std::vector<double> th = x;
+        std::vector<double> sp = x;
+        mml::act_sigmoid<double>(sig.data(), size);
+        mml::act_tanh<double>(th.data(), size);
+        mml::act_softplus<double>(sp.data(), size);
+
+        double sig_error = 0.0;
+        double th_error = 0.0;
+        double sp_error = 0.0;
+        for (size_t i = 0; i < size; i++)
+        {
+            sig_error = std::max(sig_error, std::abs(sig[i] - 1.0 / (1.0 + std::exp(-x[i]))));
+            th_error = std::max(th_error, std::abs(th[i] - std::tanh(x[i])));
+            sp_error = std::max(sp_error, std::abs(sp[i] - std::log1p(std::exp(x[i]))));
+        }
+        out = out && test(0.0, sig_error, 1E-8, "Failed activation sigmoid");
+        out = out && test(0.0, th_error, 1E-8, "Failed activation tanh");
+        out = out && test(0.0, sp_error, 1E-13, "Failed activation softplus");
+
+        // Saturation and large arguments
+        out = out && test(0.0, mml::act_sigmoid<double>(-50.0), 1E-16, "Failed activation sigmoid saturation");
+        out = out && test(1.0, mml::act_sigmoid<double>(50.0), 1E-16, "Failed activation sigmoid saturation");
+        out = out && test(-1.0, mml::act_tanh<double>(-50.0), 1E-16, "Failed activation tanh saturation");
+        out = out && test(1000.0, mml::act_softplus<double>(1000.0), 1E-12, "Failed activation softplus overflow");
+    }
+
+    return out;
+}
+
+#endif
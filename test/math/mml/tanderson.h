@@ -0,0 +1,94 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __TESTANDERSON__
+#define __TESTANDERSON__
+
+#include <cmath>
+#include <mml/anderson.h>
+#include <mml/mat.h>
+#include <mml/mult.h>
+#include <mml/test.h>
+#include <mml/vec.h>
+
+// Slowly contracting nonlinear map, picard iteration needs 64 evaluations
+mml::vector<double, 3> a1(const mml::vector<double, 3> &x)
+{
+    mml::vector<double, 3> out;
+    out[0] = 0.5 * std::cos(x[1]) + 0.45 * x[0];
+    out[1] = 0.3 * std::sin(x[0] + x[2]) + 0.6 * x[1] + 0.2;
+    out[2] = 0.9 * x[2] + 0.05 * x[0] * x[1] + 0.1;
+    return out;
+}
+
+bool test_anderson()
+{
+    bool out = true;
+
+    // Test nonlinear fixed point
+    {
+        mml::anderson<double, 3> solver(a1);
+        mml::vector<double, 3> x0;
+        mml::vector<double, 3> x1;
+        const double convergence = solver.solve(x0, x1);
+        const mml::vector<double, 3> g = a1(x1);
+        out = out && test(0.0, convergence, 1E-8, "Failed anderson nonlinear convergence");
+        out = out && test(g[0], x1[0], 1E-4, "Failed anderson nonlinear fixed point");
+        out = out && test(g[1], x1[1], 1E-4, "Failed anderson nonlinear fixed point");
+        out = out && test(g[2], x1[2], 1E-4, "Failed anderson nonlinear fixed point");
+        out = out && test(true, solver.get_evaluations() < 20, "Failed anderson nonlinear evaluations");
+    }
+
+    // Test linear fixed point with a lambda, a full window solves it in N + 2 evaluations
+    {
+        double values[9] = {0.9, 0.05, 0.0, -0.05, 0.9, 0.02, 0.0, 0.03, 0.95};
+        mml::matrix<double, 3, 3> A;
+        for (size_t i = 0; i < 9; i++)
+        {
+            A.get(i / 3, i % 3) = values[i];
+        }
+        const mml::vector<double, 3> b(1.0);
+        mml::anderson<double, 3, 3> solver([&A, &b](const mml::vector<double, 3> &x) {
+            return mml::multiply<double, 3, 3>(A, x) + b;
+        });
+        solver.set_tolerance(1E-16);
+
+        mml::vector<double, 3> x0;
+        mml::vector<double, 3> x1;
+        const double convergence = solver.solve(x0, x1);
+
+        // Compare with direct solution of (I - A) x = b
+        const mml::vector<double, 3> x = (mml::matrix<double, 3, 3>() - A).ludecomp(b);
+        out = out && test(0.0, convergence, 1E-16, "Failed anderson linear convergence");
+        out = out && test(x[0], x1[0], 1E-6, "Failed anderson linear fixed point");
+        out = out && test(x[1], x1[1], 1E-6, "Failed anderson linear fixed point");
+        out = out && test(x[2], x1[2], 1E-6, "Failed anderson linear fixed point");
+        out = out && test(true, solver.get_evaluations() <= 6, "Failed anderson linear evaluations");
+    }
+
+    // Test damped iteration with a single history entry
+    {
+        mml::anderson<double, 3, 1> solver(a1);
+        solver.set_damping(0.5);
+        mml::vector<double, 3> x0;
+        mml::vector<double, 3> x1;
+        const double convergence = solver.solve(x0, x1);
+        out = out && test(0.0, convergence, 1E-8, "Failed anderson damped convergence");
+        out = out && test(a1(x1)[2], x1[2], 1E-4, "Failed anderson damped fixed point");
+    }
+
+    return out;
+}
+
+#endif
@@ -0,0 +1,252 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __TESTBATCH__
+#define __TESTBATCH__
+
+#include <mml/batch.h>
+#include <mml/equation.h>
+#include <mml/mat.h>
+#include <mml/numeric.h>
+#include <mml/test.h>
+#include <mml/vec.h>
+#include <vector>
+
+// Nonlinear system with a root at (1, 2, 2)
+double b1(const mml::vector<double, 3> &x)
+{
+    return x[0] * x[0] + x[1] - 3.0;
+}
+
+double b2(const mml::vector<double, 3> &x)
+{
+    return x[0] + x[1] * x[1] - 5.0;
+}
+
+double b3(const mml::vector<double, 3> &x)
+{
+    return x[2] - x[0] * x[1];
+}
+
+// Same system evaluated over a batch of 8 lanes
+void bb(const mml::vector_batch<double, 3, 8> &x, mml::vector_batch<double, 3, 8> &y)
+{
+    for (size_t l = 0; l < 8; l++)
+    {
+        y[0][l] = x[0][l] * x[0][l] + x[1][l] - 3.0;
+        y[1][l] = x[0][l] + x[1][l] * x[1][l] - 5.0;
+        y[2][l] = x[2][l] - x[0][l] * x[1][l];
+    }
+}
+
+bool test_batch()
+{
+    bool out = true;
+
+    // Test batched ludecomp against scalar ludecomp
+    {
+        mml::matrix_batch<double, 3, 3, 8> A;
+        mml::vector_batch<double, 3, 8> B(1.0);
+        for (size_t l = 0; l < 8; l++)
+        {
+            double values[9] = {1.0 + l, 2.0, -2.0, 2.0, 0.5 * l, -5.0, 1.0, -4.0, 1.0};
+            mml::matrix<double, 3, 3> a;
+            for (size_t i = 0; i < 9; i++)
+            {
+                a.get(i / 3, i % 3) = values[i];
+            }
+            A.set(l, a);
+            B[0][l] = l;
+        }
+
+        // Solve all lanes
+        mml::vector<double, 8> singular;
+        const mml::vector_batch<double, 3, 8> X = A.ludecomp(B, singular);
+        for (size_t l = 0; l < 8; l++)
+        {
+            const mml::vector<double, 3> x = A.get(l).ludecomp(B.get(l));
+            out = out && test(0.0, singular[l], 1E-4, "Failed batch ludecomp singular");
+            out = out && test(x[0], X[0][l], 1E-8, "Failed batch ludecomp");
+            out = out && test(x[1], X[1][l], 1E-8, "Failed batch ludecomp");
+            out = out && test(x[2], X[2][l], 1E-8, "Failed batch ludecomp");
+        }
+    }
+
+    // Test singular lane is flagged
+    {
+        mml::matrix_batch<double, 2, 2, 4> A;
+        A.get(1, 1)[2] = 0.0;
+        mml::vector_batch<double, 2, 4> B(1.0);
+        mml::vector<double, 4> singular;
+        const mml::vector_batch<double, 2, 4> X = A.ludecomp(B, singular);
+        out = out && test(0.0, singular[1], 1E-4, "Failed batch singular flag");
+        out = out && test(1.0, singular[2], 1E-4, "Failed batch singular flag");
+        out = out && test(1.0, X[1][1], 1E-8, "Failed batch singular solve");
+        out = out && test(0.0, X[1][2], 1E-8, "Failed batch singular solve");
+
+        // Inverse flags the same lane
+        mml::vector<double, 4> flag;
+        const mml::matrix_batch<double, 2, 2, 4> inv = A.inverse(flag);
+        out = out && test(0.0, flag[1], 1E-4, "Failed batch singular inverse flag");
+        out = out && test(1.0, flag[2], 1E-4, "Failed batch singular inverse flag");
+        out = out && test(1.0, inv.get(1, 1)[1], 1E-8, "Failed batch singular inverse");
+        out = out && test(0.0, inv.get(1, 1)[2], 1E-8, "Failed batch singular inverse");
+    }
+
+    // Test reusable factorization, determinant and inverse
+    {
+        mml::matrix_batch<double, 4, 4, 4> A;
+        for (size_t l = 0; l < 4; l++)
+        {
+            double values[16] = {2.0, -1.0, 0.0, 1.0 * l, -1.0, 2.0, -1.0, 0.0, 0.0, -1.0, 2.0, -1.0, 0.5 * l, 0.0, -1.0, 2.0};
+            mml::matrix<double, 4, 4> a;
+            for (size_t i = 0; i < 16; i++)
+            {
+                a.get(i / 4, i % 4) = values[i];
+            }
+            A.set(l, a);
+        }
+
+        // Compare with scalar matrix kernels
+        const mml::lu_batch<double, 4, 4> lu(A);
+        const mml::vector<double, 4> det = lu.determinant();
+        const mml::matrix_batch<double, 4, 4, 4> inv = A.inverse();
+        for (size_t l = 0; l < 4; l++)
+        {
+            const mml::matrix<double, 4, 4> a = A.get(l);
+            const mml::matrix<double, 4, 4> ainv = a.inverse();
+            out = out && test(a.determinant(), det[l], 1E-8, "Failed batch determinant");
+            out = out && test(ainv.get(0, 0), inv.get(0, 0)[l], 1E-8, "Failed batch inverse");
+            out = out && test(ainv.get(0, 3), inv.get(0, 3)[l], 1E-8, "Failed batch inverse");
+            out = out && test(ainv.get(3, 1), inv.get(3, 1)[l], 1E-8, "Failed batch inverse");
+        }
+
+        // Solve two right hand sides with one factorization
+        mml::vector_batch<double, 4, 4> B1(1.0);
+        mml::vector_batch<double, 4, 4> B2(-2.0);
+        const mml::vector_batch<double, 4, 4> X1 = lu.solve(B1);
+        const mml::vector_batch<double, 4, 4> X2 = lu.solve(B2);
+        for (size_t l = 0; l < 4; l++)
+        {
+            out = out && test(-2.0 * X1[2][l], X2[2][l], 1E-8, "Failed batch lu solve");
+        }
+    }
+
+    // Test determinant of exactly singular lane is zero
+    {
+        mml::matrix_batch<double, 3, 3, 2> A;
+        A.get(2, 0)[1] = 1.0;
+        A.get(2, 2)[1] = 0.0;
+        const mml::vector<double, 2> det = A.determinant();
+        out = out && test(1.0, det[0], 1E-8, "Failed batch singular determinant");
+        out = out && test(0.0, det[1], 1E-8, "Failed batch singular determinant");
+    }
+
+    // Test K independent matrices not divisible by lane width
+    {
+        std::vector<mml::matrix<double, 3, 3>> A(11);
+        std::vector<mml::vector<double, 3>> B(11);
+        for (size_t k = 0; k < 11; k++)
+        {
+            A[k].get(0, 1) = 0.1 * k;
+            A[k].get(1, 0) = -0.2 * k;
+            A[k].get(2, 2) = 1.0 + k;
+            B[k] = mml::vector<double, 3>(1.0 * k);
+        }
+        const std::vector<double> det = mml::batch_determinant<4>(A);
+        const std::vector<mml::matrix<double, 3, 3>> inv = mml::batch_inverse<4>(A);
+        const std::vector<mml::vector<double, 3>> X = mml::batch_ludecomp<4>(A, B);
+        for (size_t k = 0; k < 11; k++)
+        {
+            const mml::vector<double, 3> x = A[k].ludecomp(B[k]);
+            out = out && test(A[k].determinant(), det[k], 1E-8, "Failed batch_determinant");
+            out = out && test(A[k].inverse().get(1, 0), inv[k].get(1, 0), 1E-8, "Failed batch_inverse");
+            out = out && test(x[0], X[k][0], 1E-8, "Failed batch_ludecomp");
+            out = out && test(x[2], X[k][2], 1E-8, "Failed batch_ludecomp");
+        }
+    }
+
+    // Test singular matrices are reported by batch_inverse and batch_ludecomp
+    {
+        std::vector<mml::matrix<double, 2, 2>> A(5);
+        std::vector<mml::vector<double, 2>> B(5, mml::vector<double, 2>(1.0));
+        A[3].get(1, 1) = 0.0;
+        std::vector<bool> inv_singular;
+        std::vector<bool> lu_singular;
+        const std::vector<mml::matrix<double, 2, 2>> inv = mml::batch_inverse<4>(A, inv_singular);
+        const std::vector<mml::vector<double, 2>> X = mml::batch_ludecomp<4>(A, B, lu_singular);
+        for (size_t k = 0; k < 5; k++)
+        {
+            out = out && test(true, inv_singular[k] == (k == 3), "Failed batch_inverse singular flag");
+            out = out && test(true, lu_singular[k] == (k == 3), "Failed batch_ludecomp singular flag");
+        }
+        out = out && test(0.0, inv[3].get(0, 0), 1E-8, "Failed batch_inverse singular");
+        out = out && test(0.0, X[3][0], 1E-8, "Failed batch_ludecomp singular");
+        out = out && test(1.0, X[4][0], 1E-8, "Failed batch_ludecomp singular");
+    }
+
+    // Test batched newton with a batch function
+    {
+        mml::batch_system<double, 3, 8> system(bb);
+        system.set_tolerance(1E-10);
+
+        // Different start in every lane
+        mml::vector_batch<double, 3, 8> x0;
+        for (size_t l = 0; l < 8; l++)
+        {
+            x0[0][l] = 1.0 + 0.1 * l;
+            x0[1][l] = 2.0 - 0.05 * l;
+            x0[2][l] = 1.0;
+        }
+
+        // Test zero in every lane
+        mml::vector_batch<double, 3, 8> x1;
+        const mml::vector<double, 8> convergence = system.zero(x0, x1);
+        for (size_t l = 0; l < 8; l++)
+        {
+            out = out && test(0.0, convergence[l], 1E-10, "Failed batch zero");
+            out = out && test(1.0, x1[0][l], 1E-4, "Failed batch zero");
+            out = out && test(2.0, x1[1][l], 1E-4, "Failed batch zero");
+            out = out && test(2.0, x1[2][l], 1E-4, "Failed batch zero");
+        }
+    }
+
+    // Test batched newton with scalar equations
+    {
+        mml::equation<double, 3, mml::center> eqs[3] = {b1, b2, b3};
+        mml::batch_system<double, 3, 4> system(eqs);
+
+        // Test jacobian at (1, 2, 2)
+        double values[3] = {1.0, 2.0, 2.0};
+        mml::vector_batch<double, 3, 4> x;
+        x.set(3, mml::vector<double, 3>(values));
+        const mml::matrix_batch<double, 3, 3, 4> j = system.jacobian(x, 1E-4);
+        out = out && test(2.0, j.get(0, 0)[3], 1E-4, "Failed batch jacobian");
+        out = out && test(4.0, j.get(1, 1)[3], 1E-4, "Failed batch jacobian");
+        out = out && test(-2.0, j.get(2, 0)[3], 1E-4, "Failed batch jacobian");
+        out = out && test(-1.0, j.get(2, 1)[3], 1E-4, "Failed batch jacobian");
+
+        // Test zero from the same start in every lane
+        mml::vector_batch<double, 3, 4> x0(1.5);
+        mml::vector_batch<double, 3, 4> x1;
+        const mml::vector<double, 4> convergence = system.zero(x0, x1);
+        out = out && test(0.0, convergence[0], 1E-4, "Failed batch equation zero");
+        out = out && test(1.0, x1[0][3], 1E-2, "Failed batch equation zero");
+        out = out && test(2.0, x1[1][3], 1E-2, "Failed batch equation zero");
+    }
+
+    return out;
+}
+
+#endif
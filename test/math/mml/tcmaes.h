@@ -0,0 +1,138 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __TESTCMAES__
+#define __TESTCMAES__
+
+#include <cmath>
+#include <mml/cmaes.h>
+#include <mml/equation.h>
+#include <mml/numeric.h>
+#include <mml/pool.h>
+#include <mml/test.h>
+#include <mml/vec.h>
+#include <stdexcept>
+#include <vector>
+
+// Rosenbrock's function has a narrow curved valley with minimum at (1, 1, 1, 1)
+double c1(const mml::vector<double, 4> &x)
+{
+    double out = 0.0;
+    for (size_t i = 0; i < 3; i++)
+    {
+        const double a = x[i + 1] - x[i] * x[i];
+        const double b = 1.0 - x[i];
+        out += 100.0 * a * a + b * b;
+    }
+    return out;
+}
+
+// Rastrigin's function has many local minima and a global minimum at the origin
+double c2(const mml::vector<double, 3> &x)
+{
+    const double pi = 3.14159265358979323846;
+    double out = 30.0;
+    for (size_t i = 0; i < 3; i++)
+    {
+        out += x[i] * x[i] - 10.0 * std::cos(2.0 * pi * x[i]);
+    }
+    return out;
+}
+
+bool test_cmaes()
+{
+    bool out = true;
+
+    // Test serial evaluation on rosenbrock
+    {
+        mml::equation<double, 4, mml::center> eq(c1);
+        mml::cmaes<double, 4, mml::center> es(eq);
+        es.seed(7);
+        mml::vector<double, 4> x0(-1.0);
+        mml::vector<double, 4> x1;
+        const double f = es.min(x0, x1);
+        out = out && test(0.0, f, 1E-8, "Failed cmaes rosenbrock minimum");
+        out = out && test(1.0, x1[0], 1E-4, "Failed cmaes rosenbrock x0");
+        out = out && test(1.0, x1[3], 1E-4, "Failed cmaes rosenbrock x3");
+    }
+
+    // Test parallel evaluation with IPOP restarts on rastrigin
+    {
+        mml::thread_pool pool(4);
+        mml::equation<double, 3, mml::center> eq(c2);
+        mml::cmaes<double, 3, mml::center> es(eq);
+        es.seed(7);
+        es.set_sigma(2.0);
+        mml::vector<double, 3> x0(3.0);
+        mml::vector<double, 3> x1;
+        const double f = es.min(x0, x1, pool);
+        out = out && test(0.0, f, 1E-8, "Failed cmaes rastrigin minimum");
+        out = out && test(0.0, x1[0], 1E-4, "Failed cmaes rastrigin x0");
+        out = out && test(0.0, x1[2], 1E-4, "Failed cmaes rastrigin x2");
+    }
+
+    // Test batched evaluation
+    {
+        mml::equation<double, 4, mml::center> eq(c1);
+        mml::cmaes<double, 4, mml::center> es(eq);
+        es.seed(7);
+        size_t calls = 0;
+        const auto batch = [&calls](const std::vector<mml::vector<double, 4>> &x, std::vector<double> &values) {
+            calls++;
+            for (size_t i = 0; i < x.size(); i++)
+            {
+                values[i] = c1(x[i]);
+            }
+        };
+        mml::vector<double, 4> x0(-1.0);
+        mml::vector<double, 4> x1;
+        const double f = es.min(x0, x1, batch);
+        out = out && test(0.0, f, 1E-8, "Failed cmaes batch minimum");
+        out = out && test(true, calls > 0, "Failed cmaes batch calls");
+    }
+
+    // Test the lazy interval counts evaluations, a small problem decomposes C every generation
+    {
+        mml::equation<double, 4, mml::center> eq(c1);
+        mml::cmaes<double, 4, mml::center> es(eq);
+        es.seed(7);
+        es.set_restarts(0);
+        es.set_evaluations(400);
+        mml::vector<double, 4> x0(-1.0);
+        mml::vector<double, 4> x1;
+        es.min(x0, x1);
+        out = out && test(true, es.get_generations() > 10, "Failed cmaes lazy generations");
+        out = out && test(true, es.get_decompositions() == es.get_generations(), "Failed cmaes lazy decompositions");
+    }
+
+    // Test a population without a parent is rejected
+    {
+        mml::equation<double, 4, mml::center> eq(c1);
+        mml::cmaes<double, 4, mml::center> es(eq);
+        bool thrown = false;
+        try
+        {
+            es.set_population(1);
+        }
+        catch (std::exception &e)
+        {
+            thrown = true;
+        }
+        out = out && test(true, thrown, "Failed cmaes population check");
+    }
+
+    return out;
+}
+
+#endif
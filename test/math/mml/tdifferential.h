@@ -0,0 +1,96 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __TESTDIFFERENTIAL__
+#define __TESTDIFFERENTIAL__
+
+#include <cmath>
+#include <mml/differential.h>
+#include <mml/pool.h>
+#include <mml/test.h>
+#include <mml/vec.h>
+
+// Rastrigin's function has many local minima and a global minimum at the origin
+double d1(const mml::vector<double, 4> &x)
+{
+    const double pi = 3.14159265358979323846;
+    double out = 40.0;
+    for (size_t i = 0; i < 4; i++)
+    {
+        out += x[i] * x[i] - 10.0 * std::cos(2.0 * pi * x[i]);
+    }
+    return out;
+}
+
+// Rosenbrock's function has a narrow curved valley with minimum at (1, 1, 1, 1)
+double d2(const mml::vector<double, 4> &x)
+{
+    double out = 0.0;
+    for (size_t i = 0; i < 3; i++)
+    {
+        const double a = x[i + 1] - x[i] * x[i];
+        const double b = 1.0 - x[i];
+        out += 100.0 * a * a + b * b;
+    }
+    return out;
+}
+
+bool test_differential()
+{
+    bool out = true;
+
+    // Search box
+    const mml::vector<double, 4> lower(-5.12);
+    const mml::vector<double, 4> upper(5.12);
+
+    // Test DE/rand/1/bin serially
+    {
+        mml::differential<double, 4> de(d1, lower, upper);
+        de.seed(7);
+        mml::vector<double, 4> x1;
+        const double f = de.min(x1);
+        out = out && test(0.0, f, 1E-6, "Failed differential rand/1 minimum");
+        out = out && test(0.0, x1[0], 1E-4, "Failed differential rand/1 x0");
+    }
+
+    // Create thread pool for fitness evaluation
+    mml::thread_pool pool(4);
+
+    // Test DE/best/2/bin in parallel
+    {
+        mml::differential<double, 4> de(d1, lower, upper);
+        de.seed(7);
+        de.set_best_2();
+        mml::vector<double, 4> x1;
+        const double f = de.min(x1, pool);
+        out = out && test(0.0, f, 1E-6, "Failed differential best/2 minimum");
+        out = out && test(0.0, x1[3], 1E-4, "Failed differential best/2 x3");
+    }
+
+    // Test jade in parallel
+    {
+        mml::differential<double, 4> de(d2, lower, upper);
+        de.seed(7);
+        de.set_jade();
+        mml::vector<double, 4> x1;
+        const double f = de.min(x1, pool);
+        out = out && test(0.0, f, 1E-6, "Failed differential jade minimum");
+        out = out && test(1.0, x1[0], 1E-3, "Failed differential jade x0");
+        out = out && test(1.0, x1[3], 1E-3, "Failed differential jade x3");
+    }
+
+    return out;
+}
+
+#endif
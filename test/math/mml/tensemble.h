@@ -0,0 +1,143 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __TESTENSEMBLE__
+#define __TESTENSEMBLE__
+
+#include <cmath>
+#include <mml/ensemble.h>
+#include <mml/pool.h>
+#include <mml/test.h>
+#include <mml/vec.h>
+#include <stdexcept>
+
+// Nonlinear non-autonomous y' = -2ty^2, solution y = 1 / (1 / y0 + t^2)
+void e1(const double *t, const double *const *y, double *const *dy, const size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        dy[0][i] = -2.0 * t[i] * y[0][i] * y[0][i];
+    }
+}
+// Harmonic oscillator for one trajectory
+mml::vector<double, 2> e2(const double t, const mml::vector<double, 2> &y)
+{
+    mml::vector<double, 2> out;
+    out[0] = y[1];
+    out[1] = -y[0];
+    return out;
+}
+
+// Largest error of the e1 ensemble at t = 2 with a fixed step
+template <typename F>
+double e1_error(F method, const double step)
+{
+    mml::ensemble<double, 1> e(e1, 16);
+    method(e);
+    for (size_t i = 0; i < 16; i++)
+    {
+        e.set(i, mml::vector<double, 1>(0.5 + 0.1 * i));
+    }
+    e.set_step(step);
+    e.integrate(0.0, 2.0);
+
+    double out = 0.0;
+    for (size_t i = 0; i < 16; i++)
+    {
+        const double exact = 1.0 / (1.0 / (0.5 + 0.1 * i) + 4.0);
+        out = std::max(out, std::abs(e.get(i)[0] - exact));
+    }
+    return out;
+}
+
+bool test_ensemble()
+{
+    bool out = true;
+
+    // Test order of convergence of each tableau, halving the step divides the error by at least 2^p
+    {
+        const auto dp = [](mml::ensemble<double, 1> &e) { e.set_dormand_prince(); };
+        const auto ts = [](mml::ensemble<double, 1> &e) { e.set_tsitouras(); };
+        const auto rk = [](mml::ensemble<double, 1> &e) { e.set_rk4(); };
+        const double dp_order = std::log2(e1_error(dp, 0.05) / e1_error(dp, 0.025));
+        const double ts_order = std::log2(e1_error(ts, 0.05) / e1_error(ts, 0.025));
+        const double rk_order = std::log2(e1_error(rk, 0.05) / e1_error(rk, 0.025));
+        out = out && test(true, dp_order > 4.7, "Failed ensemble dormand-prince order");
+        out = out && test(true, ts_order > 4.7, "Failed ensemble tsitouras order");
+        out = out && test(true, rk_order > 3.7, "Failed ensemble rk4 order");
+    }
+
+    // Test adaptive ensemble of oscillators with different phases, in chunks across threads
+    {
+        const size_t size = 1000;
+        mml::ensemble<double, 2> e(e2, size);
+        e.set_tolerance(1E-9, 1E-12);
+        e.set_chunk(64);
+        for (size_t i = 0; i < size; i++)
+        {
+            mml::vector<double, 2> y;
+            y[0] = std::cos(0.01 * i);
+            y[1] = -std::sin(0.01 * i);
+            e.set(i, y);
+        }
+        mml::thread_pool pool(4);
+        e.integrate(0.0, 10.0, pool);
+        for (size_t i = 0; i < size; i += 37)
+        {
+            out = out && test(std::cos(10.0 + 0.01 * i), e.get(i)[0], 1E-6, "Failed ensemble dormand-prince oscillator");
+            out = out && test(-std::sin(10.0 + 0.01 * i), e.get(i)[1], 1E-6, "Failed ensemble dormand-prince oscillator");
+        }
+
+        // Continue integration with tsitouras
+        e.set_tsitouras();
+        e.integrate(10.0, 20.0, pool);
+        for (size_t i = 0; i < size; i += 37)
+        {
+            out = out && test(std::cos(20.0 + 0.01 * i), e.get(i)[0], 1E-6, "Failed ensemble tsitouras oscillator");
+        }
+        out = out && test(true, e.get_steps() < size * 1000, "Failed ensemble step count");
+    }
+
+    // Test adaptive steps on the nonlinear problem
+    {
+        mml::ensemble<double, 1> e(e1, 3);
+        e.set_tsitouras();
+        e.set(0, mml::vector<double, 1>(1.0));
+        e.set(1, mml::vector<double, 1>(10.0));
+        e.set(2, mml::vector<double, 1>(-0.1));
+        e.integrate(0.0, 3.0);
+        out = out && test(0.1, e.get(0)[0], 1E-6, "Failed ensemble adaptive nonlinear");
+        out = out && test(1.0 / 9.1, e.get(1)[0], 1E-6, "Failed ensemble adaptive nonlinear");
+        out = out && test(-1.0, e.get(2)[0], 1E-4, "Failed ensemble adaptive nonlinear");
+    }
+
+    // Test integrating backward in time is rejected
+    {
+        mml::ensemble<double, 1> e(e1, 3);
+        bool thrown = false;
+        try
+        {
+            e.integrate(3.0, 0.0);
+        }
+        catch (std::exception &ex)
+        {
+            thrown = true;
+        }
+        out = out && test(true, thrown, "Failed ensemble backward interval check");
+    }
+
+    return out;
+}
+
+#endif
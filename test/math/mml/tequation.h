@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <mml/equation.h>
 #include <mml/numeric.h>
+#include <mml/pool.h>
 #include <mml/test.h>
 #include <mml/vec.h>
 
@@ -25,6 +26,21 @@ double g1(const mml::vector<double, 3> &x)
     return x[0] * x[0] + 2.0 * x[1] * x[1] + 2.0 * x[2] * x[2] + 15;
 }
 
+double g2(const mml::vector<double, 3> &x)
+{
+    return x[0] * x[0] + 50.0 * x[1] * x[1] + 1000.0 * x[2] * x[2] + x[0] * x[1] - 5.0;
+}
+
+double g3(const mml::vector<double, 3> &x)
+{
+    return (x[0] * x[0] - 1.0) * (x[0] * x[0] - 1.0) + x[1] * x[1] + 2.0 * x[2] * x[2];
+}
+
+double g4(const mml::vector<double, 3> &x)
+{
+    return std::abs(x[0] - 1.0) + 2.0 * std::abs(x[1] + 2.0) + std::abs(x[2]) + 3.0;
+}
+
 bool test_equation()
 {
     bool out = true;
@@ -64,6 +80,46 @@ bool test_equation()
         out = out && test(0.0, x1[1], 1E-4, "Failed equation backward min");
         out = out && test(0.0, x1[2], 1E-4, "Failed equation backward min");
 
+        // Test min_bfgs cold start from a scaled identity inverse hessian
+        convergence = eqs[0].min_bfgs(x0, x1, 20, 1E-7);
+
+        // Evaluate g1 at x1
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation backward min_bfgs cold start");
+        out = out && test(15.0, y1, 1E-4, "Failed equation backward min_bfgs cold start");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation backward min_bfgs cold start");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation backward min_bfgs cold start");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation backward min_bfgs cold start");
+
+        // Test min_bfgs
+        mml::matrix<double, 3, 3> hinv;
+        convergence = eqs[0].min_bfgs(x0, x1, hinv, 20, 1E-7);
+
+        // Evaluate g1 at x1
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation backward min_bfgs");
+        out = out && test(15.0, y1, 1E-4, "Failed equation backward min_bfgs");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation backward min_bfgs");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation backward min_bfgs");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation backward min_bfgs");
+
+        // Test min_bfgs warm start from previous inverse hessian
+        convergence = eqs[0].min_bfgs(x0 * -1.0, x1, hinv, 20, 1E-7);
+
+        // Evaluate g1 at x1
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (-10.0, -10.0, -10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation backward min_bfgs warm start");
+        out = out && test(15.0, y1, 1E-4, "Failed equation backward min_bfgs warm start");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation backward min_bfgs warm start");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation backward min_bfgs warm start");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation backward min_bfgs warm start");
+
         // Test hessian calculation
         mml::matrix<double, 3, 3> h = mml::backward<double, 3>::hessian(eqs[0], x0, 1E-3);
         out = out && test(2.0, h.get(0, 0), 1E-4, "Failed equation backward hessian");
@@ -111,6 +167,46 @@ bool test_equation()
         out = out && test(0.0, x1[1], 1E-4, "Failed equation center min");
         out = out && test(0.0, x1[2], 1E-4, "Failed equation center min");
 
+        // Test min_bfgs cold start from a scaled identity inverse hessian
+        convergence = eqs[0].min_bfgs(x0, x1, 20, 1E-7);
+
+        // Evaluate g1 at x1
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation center min_bfgs cold start");
+        out = out && test(15.0, y1, 1E-4, "Failed equation center min_bfgs cold start");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation center min_bfgs cold start");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation center min_bfgs cold start");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation center min_bfgs cold start");
+
+        // Test min_bfgs
+        mml::matrix<double, 3, 3> hinv;
+        convergence = eqs[0].min_bfgs(x0, x1, hinv, 20, 1E-7);
+
+        // Evaluate g1 at x1
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation center min_bfgs");
+        out = out && test(15.0, y1, 1E-4, "Failed equation center min_bfgs");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation center min_bfgs");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation center min_bfgs");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation center min_bfgs");
+
+        // Test min_bfgs warm start from previous inverse hessian
+        convergence = eqs[0].min_bfgs(x0 * -1.0, x1, hinv, 20, 1E-7);
+
+        // Evaluate g1 at x1
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (-10.0, -10.0, -10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation center min_bfgs warm start");
+        out = out && test(15.0, y1, 1E-4, "Failed equation center min_bfgs warm start");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation center min_bfgs warm start");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation center min_bfgs warm start");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation center min_bfgs warm start");
+
         // Test hessian calculation
         mml::matrix<double, 3, 3> h = mml::center<double, 3>::hessian(eqs[0], x0, 1E-3);
         out = out && test(2.0, h.get(0, 0), 1E-4, "Failed equation center hessian");
@@ -159,6 +255,46 @@ bool test_equation()
         out = out && test(0.0, x1[1], 1E-4, "Failed equation forward min");
         out = out && test(0.0, x1[2], 1E-4, "Failed equation forward min");
 
+        // Test min_bfgs cold start from a scaled identity inverse hessian
+        convergence = eqs[0].min_bfgs(x0, x1, 20, 1E-7);
+
+        // Evaluate g1 at x1
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation forward min_bfgs cold start");
+        out = out && test(15.0, y1, 1E-4, "Failed equation forward min_bfgs cold start");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation forward min_bfgs cold start");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation forward min_bfgs cold start");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation forward min_bfgs cold start");
+
+        // Test min_bfgs
+        mml::matrix<double, 3, 3> hinv;
+        convergence = eqs[0].min_bfgs(x0, x1, hinv, 20, 1E-7);
+
+        // Evaluate g1 at x1
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation forward min_bfgs");
+        out = out && test(15.0, y1, 1E-4, "Failed equation forward min_bfgs");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation forward min_bfgs");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation forward min_bfgs");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation forward min_bfgs");
+
+        // Test min_bfgs warm start from previous inverse hessian
+        convergence = eqs[0].min_bfgs(x0 * -1.0, x1, hinv, 20, 1E-7);
+
+        // Evaluate g1 at x1
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (-10.0, -10.0, -10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation forward min_bfgs warm start");
+        out = out && test(15.0, y1, 1E-4, "Failed equation forward min_bfgs warm start");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation forward min_bfgs warm start");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation forward min_bfgs warm start");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation forward min_bfgs warm start");
+
         // Test hessian calculation
         mml::matrix<double, 3, 3> h = mml::forward<double, 3>::hessian(eqs[0], x0, 1E-3);
         out = out && test(2.0, h.get(0, 0), 1E-4, "Failed equation forward hessian");
@@ -172,6 +308,196 @@ bool test_equation()
         out = out && test(4.0, h.get(2, 2), 1E-4, "Failed equation forward hessian");
     }
 
+    // Nonlinear conjugate gradient
+    {
+        // Create ill-conditioned equation
+        mml::equation<double, 3, mml::center> eqs[1] = {g2};
+
+        // Test solving for the local minimum of g2
+        mml::vector<double, 3> x0(1.0);
+        mml::vector<double, 3> x1;
+
+        // Test min_fletcher_reeves
+        double convergence = eqs[0].min_fletcher_reeves(x0, x1, 20, 1E-7);
+        double y1 = g2(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (1.0, 1.0, 1.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_fletcher_reeves");
+        out = out && test(-5.0, y1, 1E-4, "Failed equation min_fletcher_reeves");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation min_fletcher_reeves");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation min_fletcher_reeves");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation min_fletcher_reeves");
+
+        // Test min_polak_ribiere
+        convergence = eqs[0].min_polak_ribiere(x0, x1, 20, 1E-7);
+        y1 = g2(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (1.0, 1.0, 1.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_polak_ribiere");
+        out = out && test(-5.0, y1, 1E-4, "Failed equation min_polak_ribiere");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation min_polak_ribiere");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation min_polak_ribiere");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation min_polak_ribiere");
+
+        // Test min_hager_zhang
+        convergence = eqs[0].min_hager_zhang(x0, x1, 20, 1E-7);
+        y1 = g2(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (1.0, 1.0, 1.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_hager_zhang");
+        out = out && test(-5.0, y1, 1E-4, "Failed equation min_hager_zhang");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation min_hager_zhang");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation min_hager_zhang");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation min_hager_zhang");
+    }
+
+    // Trust region newton
+    {
+        // Create convex and nonconvex equations
+        mml::equation<double, 3, mml::center> eqs[2] = {g1, g3};
+
+        // Test solving for the local minimum of g1
+        mml::vector<double, 3> x0(10.0);
+        mml::vector<double, 3> x1;
+
+        // Test min_newton_cg
+        double convergence = eqs[0].min_newton_cg(x0, x1, 50, 1E-6);
+        double y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_newton_cg");
+        out = out && test(15.0, y1, 1E-4, "Failed equation min_newton_cg");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation min_newton_cg");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation min_newton_cg");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation min_newton_cg");
+
+        // Test min_dogleg
+        convergence = eqs[0].min_dogleg(x0, x1, 50, 1E-6);
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_dogleg");
+        out = out && test(15.0, y1, 1E-4, "Failed equation min_dogleg");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation min_dogleg");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation min_dogleg");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation min_dogleg");
+
+        // Start near local maximum of g3 at x = 0.0, hessian is indefinite
+        x0[0] = 0.1;
+        x0[1] = 1.0;
+        x0[2] = 1.0;
+
+        // Test min_newton_cg on nonconvex function
+        convergence = eqs[1].min_newton_cg(x0, x1, 50, 1E-6);
+        y1 = g3(x1);
+
+        // Test if found min at (1.0, 0.0, 0.0) at starting point (0.1, 1.0, 1.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_newton_cg nonconvex");
+        out = out && test(0.0, y1, 1E-4, "Failed equation min_newton_cg nonconvex");
+        out = out && test(1.0, x1[0], 1E-3, "Failed equation min_newton_cg nonconvex");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation min_newton_cg nonconvex");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation min_newton_cg nonconvex");
+
+        // Test min_dogleg on nonconvex function
+        convergence = eqs[1].min_dogleg(x0, x1, 50, 1E-6);
+        y1 = g3(x1);
+
+        // Test if found min at (1.0, 0.0, 0.0) at starting point (0.1, 1.0, 1.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_dogleg nonconvex");
+        out = out && test(0.0, y1, 1E-4, "Failed equation min_dogleg nonconvex");
+        out = out && test(1.0, x1[0], 1E-3, "Failed equation min_dogleg nonconvex");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation min_dogleg nonconvex");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation min_dogleg nonconvex");
+    }
+
+    // Box constrained
+    {
+        // Create equation array
+        mml::equation<double, 3, mml::center> eqs[1] = {g1};
+
+        // Test solving for the constrained minimum of g1
+        mml::vector<double, 3> x0(10.0);
+        mml::vector<double, 3> x1;
+
+        // Set bounds excluding unconstrained minimum
+        double lo[3] = {1.0, -1.0, 0.5};
+        double up[3] = {2.0, 1.0, 3.0};
+        mml::vector<double, 3> lower(lo);
+        mml::vector<double, 3> upper(up);
+
+        // Test min_box
+        double convergence = eqs[0].min_box(x0, x1, lower, upper, 50, 1E-7);
+        double y1 = g1(x1);
+
+        // Test if found min at (1.0, 0.0, 0.5) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_box");
+        out = out && test(16.5, y1, 1E-4, "Failed equation min_box");
+        out = out && test(1.0, x1[0], 1E-4, "Failed equation min_box");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation min_box");
+        out = out && test(0.5, x1[2], 1E-4, "Failed equation min_box");
+
+        // Set bounds containing unconstrained minimum
+        lower = -5.0;
+        upper = 20.0;
+
+        // Test min_box with inactive bounds
+        convergence = eqs[0].min_box(x0, x1, lower, upper, 50, 1E-7);
+        y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_box inactive");
+        out = out && test(15.0, y1, 1E-4, "Failed equation min_box inactive");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation min_box inactive");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation min_box inactive");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation min_box inactive");
+    }
+
+    // Derivative free
+    {
+        // Create smooth and non-smooth equations
+        mml::equation<double, 3, mml::center> eqs[2] = {g1, g4};
+
+        // Create thread pool for concurrent evaluations
+        mml::thread_pool pool(4);
+
+        // Test solving for the local minimum of g1
+        mml::vector<double, 3> x0(10.0);
+        mml::vector<double, 3> x1;
+
+        // Test min_nelder_mead
+        double convergence = eqs[0].min_nelder_mead(x0, x1, 1000, 1E-8);
+        double y1 = g1(x1);
+
+        // Test if found min at (0.0, 0.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_nelder_mead");
+        out = out && test(15.0, y1, 1E-4, "Failed equation min_nelder_mead");
+        out = out && test(0.0, x1[0], 1E-3, "Failed equation min_nelder_mead");
+        out = out && test(0.0, x1[1], 1E-3, "Failed equation min_nelder_mead");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation min_nelder_mead");
+
+        // Test min_nelder_mead with concurrent trial points on non-smooth function
+        convergence = eqs[1].min_nelder_mead(x0, x1, 1000, 1E-8, pool);
+        y1 = g4(x1);
+
+        // Test if found min at (1.0, -2.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_nelder_mead parallel");
+        out = out && test(3.0, y1, 1E-4, "Failed equation min_nelder_mead parallel");
+        out = out && test(1.0, x1[0], 1E-3, "Failed equation min_nelder_mead parallel");
+        out = out && test(-2.0, x1[1], 1E-3, "Failed equation min_nelder_mead parallel");
+        out = out && test(0.0, x1[2], 1E-3, "Failed equation min_nelder_mead parallel");
+
+        // Test min_pattern with concurrent polling on non-smooth function
+        convergence = eqs[1].min_pattern(x0, x1, 1000, 1E-8, pool);
+        y1 = g4(x1);
+
+        // Test if found min at (1.0, -2.0, 0.0) at starting point (10.0, 10.0, 10.0)
+        out = out && test(0.0, convergence, 1E-4, "Failed equation min_pattern");
+        out = out && test(3.0, y1, 1E-4, "Failed equation min_pattern");
+        out = out && test(1.0, x1[0], 1E-4, "Failed equation min_pattern");
+        out = out && test(-2.0, x1[1], 1E-4, "Failed equation min_pattern");
+        out = out && test(0.0, x1[2], 1E-4, "Failed equation min_pattern");
+    }
+
     return out;
 }
 
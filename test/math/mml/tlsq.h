@@ -0,0 +1,84 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __TESTLEASTSQUARES__
+#define __TESTLEASTSQUARES__
+
+#include <mml/equation.h>
+#include <mml/lsq.h>
+#include <mml/numeric.h>
+#include <mml/test.h>
+#include <mml/vec.h>
+
+// Noisy samples of y = 2.0 * exp(-0.5 * t) at t = [0, 5]
+const double lsq_y[6] = {2.0, 1.223061, 0.725759, 0.451260, 0.270671, 0.159170};
+
+template <size_t I>
+double r1(const mml::vector<double, 2> &x)
+{
+    return x[0] * std::exp(x[1] * I) - lsq_y[I];
+}
+
+bool test_least_squares()
+{
+    bool out = true;
+
+    // Create residual array
+    mml::equation<double, 2, mml::center> eqs[6] = {r1<0>, r1<1>, r1<2>, r1<3>, r1<4>, r1<5>};
+
+    // Create least squares problem
+    mml::lsq<double, 6, 2, mml::center> lsq(eqs);
+    lsq.set_tolerance(1E-8);
+
+    // Set the x value starting position
+    double values[2] = {2.0, -0.5};
+    mml::vector<double, 2> x(values);
+
+    // Test lsq evaluate, should be close to zero
+    mml::vector<double, 6> y = lsq.evaluate(x);
+    out = out && test(0.0, y[0], 1E-4, "Failed lsq evaluate");
+    out = out && test(0.0, y[4], 1E-4, "Failed lsq evaluate");
+
+    // Test jacobian, dr/da = exp(b*t), dr/db = a*t*exp(b*t)
+    mml::matrix<double, 6, 2> j = lsq.jacobian(x, 1E-4);
+    out = out && test(1.0, j.get(0, 0), 1E-4, "Failed lsq jacobian");
+    out = out && test(0.0, j.get(0, 1), 1E-4, "Failed lsq jacobian");
+    out = out && test(0.367879, j.get(2, 0), 1E-4, "Failed lsq jacobian");
+    out = out && test(1.471518, j.get(2, 1), 1E-4, "Failed lsq jacobian");
+
+    // Test fitting the model from (1.0, 0.0)
+    mml::vector<double, 2> x0;
+    mml::vector<double, 2> x1;
+    x0[0] = 1.0;
+
+    // Test levenberg-marquardt
+    double cost = lsq.min(x0, x1);
+    out = out && test(0.0, cost, 1E-3, "Failed lsq min");
+    out = out && test(2.0, x1[0], 1E-2, "Failed lsq min");
+    out = out && test(-0.5, x1[1], 1E-2, "Failed lsq min");
+
+    // Cache the solution
+    const mml::vector<double, 2> cached = x1;
+
+    // Test levenberg-marquardt with geodesic acceleration
+    lsq.set_geodesic(true);
+    cost = lsq.min(x0, x1);
+    out = out && test(0.0, cost, 1E-3, "Failed lsq min geodesic");
+    out = out && test(cached[0], x1[0], 1E-4, "Failed lsq min geodesic");
+    out = out && test(cached[1], x1[1], 1E-4, "Failed lsq min geodesic");
+
+    return out;
+}
+
+#endif
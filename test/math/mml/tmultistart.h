@@ -0,0 +1,95 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __TESTMULTISTART__
+#define __TESTMULTISTART__
+
+#include <mml/equation.h>
+#include <mml/multistart.h>
+#include <mml/numeric.h>
+#include <mml/pool.h>
+#include <mml/test.h>
+#include <mml/vec.h>
+
+// Himmelblau's function has four minima equal to zero
+double h1(const mml::vector<double, 2> &x)
+{
+    const double a = x[0] * x[0] + x[1] - 11.0;
+    const double b = x[0] + x[1] * x[1] - 7.0;
+    return a * a + b * b;
+}
+
+bool test_multistart()
+{
+    bool out = true;
+
+    // Test sobol sequence
+    {
+        mml::sobol<3> seq;
+        mml::vector<double, 3> x = seq.next<double>();
+        out = out && test(0.5, x[0], 1E-4, "Failed sobol sequence");
+        out = out && test(0.5, x[1], 1E-4, "Failed sobol sequence");
+        out = out && test(0.5, x[2], 1E-4, "Failed sobol sequence");
+
+        x = seq.next<double>();
+        out = out && test(0.75, x[0], 1E-4, "Failed sobol sequence");
+        out = out && test(0.25, x[1], 1E-4, "Failed sobol sequence");
+        out = out && test(0.25, x[2], 1E-4, "Failed sobol sequence");
+
+        x = seq.next<double>();
+        out = out && test(0.25, x[0], 1E-4, "Failed sobol sequence");
+        out = out && test(0.75, x[1], 1E-4, "Failed sobol sequence");
+        out = out && test(0.75, x[2], 1E-4, "Failed sobol sequence");
+    }
+
+    // Create equation and bounds
+    mml::equation<double, 2, mml::center> eq(h1);
+    mml::vector<double, 2> lower(-5.0);
+    mml::vector<double, 2> upper(5.0);
+
+    // Create thread pool for local solves
+    mml::thread_pool pool(4);
+
+    // Test sobol multistart
+    {
+        mml::multistart<double, 2, mml::center> ms(eq, lower, upper);
+        std::vector<std::pair<double, mml::vector<double, 2>>> minima = ms.min(4, pool);
+
+        // Test all four minima were found
+        out = out && test(4, minima.size(), "Failed multistart sobol minima count");
+        for (const auto &m : minima)
+        {
+            out = out && test(0.0, m.first, 1E-6, "Failed multistart sobol minimum");
+            out = out && test(0.0, h1(m.second), 1E-6, "Failed multistart sobol minimum");
+        }
+    }
+
+    // Test latin hypercube multistart
+    {
+        mml::multistart<double, 2, mml::center> ms(eq, lower, upper);
+        ms.set_latin();
+        ms.set_starts(128);
+        ms.seed(7);
+        std::vector<std::pair<double, mml::vector<double, 2>>> minima = ms.min(2, pool);
+
+        // Test best two minima were returned
+        out = out && test(2, minima.size(), "Failed multistart latin minima count");
+        out = out && test(0.0, minima[0].first, 1E-6, "Failed multistart latin minimum");
+        out = out && test(0.0, minima[1].first, 1E-6, "Failed multistart latin minimum");
+    }
+
+    return out;
+}
+
+#endif
@@ -15,9 +15,77 @@ limitations under the License.
 #ifndef __TEST_NEURAL_NET__
 #define __TEST_NEURAL_NET__
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <mml/nnet.h>
+#include <mml/pool.h>
 #include <mml/test.h>
 #include <mml/vec.h>
+#include <vector>
+
+// Deterministic weights for training tests that must not depend on the random seed
+template <typename T, size_t IN, size_t OUT>
+void nnet_init(mml::nnet<T, IN, OUT> &net)
+{
+    std::vector<T> data = net.serialize();
+    const size_t layers = static_cast<size_t>(data[2]);
+    size_t inputs = IN;
+    size_t end = 3 + layers;
+    for (size_t i = 0; i < layers; i++)
+    {
+        const size_t size = static_cast<size_t>(data[3 + i]);
+        end += size * (inputs + 1);
+        inputs = size;
+    }
+
+    // Activation codes after the weights are kept
+    for (size_t k = 3 + layers; k < end; k++)
+    {
+        data[k] = 0.5 * std::sin(1.3 * k);
+    }
+    net.deserialize(data);
+}
+
+// Inputs on an n x n grid over [-1, 1), set points are f(x, y)
+template <typename F>
+void nnet_grid(const size_t n, std::vector<mml::vector<double, 2>> &in, std::vector<mml::vector<double, 1>> &sp, const F &f)
+{
+    in.resize(n * n);
+    sp.resize(n * n);
+    for (size_t i = 0; i < n * n; i++)
+    {
+        in[i][0] = -1.0 + 2.0 * (i % n) / n;
+        in[i][1] = -1.0 + 2.0 * (i / n) / n;
+        sp[i][0] = f(in[i][0], in[i][1]);
+    }
+}
+
+// Sum of squared errors of a batch of outputs
+template <typename T, size_t OUT>
+T nnet_error(const std::vector<mml::vector<T, OUT>> &output, const std::vector<mml::vector<T, OUT>> &sp)
+{
+    T error = 0.0;
+    for (size_t i = 0; i < output.size(); i++)
+    {
+        error += (output[i] - sp[i]).square_magnitude();
+    }
+    return error;
+}
+
+// Largest absolute difference between the parameters of two nets
+template <typename T, size_t IN, size_t OUT>
+T max_param_diff(const mml::nnet<T, IN, OUT> &a, const mml::nnet<T, IN, OUT> &b)
+{
+    const std::vector<T> d1 = a.serialize();
+    const std::vector<T> d2 = b.serialize();
+    T diff = 0.0;
+    for (size_t i = 0; i < d1.size(); i++)
+    {
+        diff = std::max(diff, std::abs(d1[i] - d2[i]));
+    }
+    return diff;
+}
 
 bool test_neural_net_fixed()
 {
@@ -414,6 +482,313 @@ bool test_neural_net_fixed()
         out = out && test(0.0, total_error, 1E-4, "Failed neural net 1x1 training z=x+y");
     }
 
+    // Mini-batch problems
+    {
+        // Random net, batch forward pass matches single sample forward pass
+        mml::nnet<double, 3, 2> net;
+        net.add_layer(5);
+        net.add_layer(7);
+        net.finalize();
+        net.randomize(rng);
+        std::vector<mml::vector<double, 3>> batch(7);
+        for (size_t i = 0; i < 7; i++)
+        {
+            batch[i][0] = 0.1 * i;
+            batch[i][1] = -0.2 * i;
+            batch[i][2] = 0.3;
+        }
+        const std::vector<mml::vector<double, 2>> outputs = net.calculate_tanh(batch);
+        for (size_t i = 0; i < 7; i++)
+        {
+            net.set_input(batch[i]);
+            const mml::vector<double, 2> single = net.calculate_tanh();
+            out = out && test(single[0], outputs[i][0], 1E-12, "Failed net batch calculate");
+            out = out && test(single[1], outputs[i][1], 1E-12, "Failed net batch calculate");
+        }
+
+        // A batch of one sample takes the same step as single sample backprop
+        mml::nnet<double, 3, 2> net2 = net;
+        std::vector<mml::vector<double, 2>> sp(1);
+        sp[0][0] = 0.5;
+        sp[0][1] = -0.5;
+        for (size_t i = 0; i < 7; i++)
+        {
+            net.set_input(batch[i]);
+            net.calculate_tanh();
+            net.backprop_tanh(sp[0], 0.1);
+            net2.calculate_tanh(std::vector<mml::vector<double, 3>>(1, batch[i]));
+            net2.backprop_tanh(sp, 0.1);
+        }
+        out = out && test(0.0, max_param_diff(net, net2), 1E-12, "Failed net batch backprop single sample");
+    }
+    {
+        // Train z = x + y with mini-batches of 64
+        mml::nnet<double, 2, 1> net;
+        net.add_layer(4);
+        net.finalize();
+        net.set_linear_output(true);
+        net.randomize(rng);
+        std::vector<mml::vector<double, 2>> in;
+        std::vector<mml::vector<double, 1>> sp;
+        nnet_grid(8, in, sp, std::plus<double>());
+        for (size_t i = 0; i < 2000; i++)
+        {
+            net.calculate_identity(in);
+            net.backprop_identity(sp, 0.02);
+        }
+        const std::vector<mml::vector<double, 1>> output = net.calculate_identity(in);
+        const double total_error = nnet_error(output, sp);
+        out = out && test(0.0, total_error, 1E-4, "Failed neural net batch training z=x+y");
+    }
+    {
+        // Shared read-only net queried from a thread pool, each task owns a workspace
+        mml::nnet<double, 3, 2> net;
+        net.add_layer(6);
+        net.finalize();
+        net.randomize(rng);
+        const std::vector<double> before = net.serialize();
+        const auto input = [](const size_t i) {
+            const double x[3] = {0.01 * i, -0.02 * i, 0.5};
+            return mml::vector<double, 3>(x);
+        };
+        std::vector<mml::vector<double, 2>> expect(64);
+        for (size_t i = 0; i < 64; i++)
+        {
+            net.set_input(input(i));
+            expect[i] = net.calculate_sigmoid();
+        }
+        const mml::nnet<double, 3, 2> &shared = net;
+        std::vector<mml::vector<double, 2>> result(64);
+        mml::thread_pool pool(4);
+        pool.run(8, [&shared, &result, &input](const size_t task) {
+            mml::nnet_workspace<double> work;
+            for (size_t i = task; i < 64; i += 8)
+            {
+                result[i] = shared.calculate_sigmoid(input(i), work);
+            }
+        });
+        for (size_t i = 0; i < 64; i++)
+        {
+            out = out && test(expect[i][0], result[i][0], 1E-12, "Failed net workspace calculate");
+            out = out && test(expect[i][1], result[i][1], 1E-12, "Failed net workspace calculate");
+        }
+        out = out && test(true, before == net.serialize(), "Failed net workspace left weights untouched");
+    }
+    {
+        // Data parallel training matches the single threaded mini-batch step
+        mml::nnet<double, 2, 1> net;
+        net.add_layer(8);
+        net.finalize();
+        net.set_linear_output(true);
+        net.randomize(rng);
+        mml::nnet<double, 2, 1> net2 = net;
+        mml::nnet<double, 2, 1> net3 = net;
+        std::vector<mml::vector<double, 2>> in;
+        std::vector<mml::vector<double, 1>> sp;
+        nnet_grid(10, in, sp, std::multiplies<double>());
+        mml::thread_pool pool(4);
+        for (size_t i = 0; i < 50; i++)
+        {
+            net.calculate_tanh(in);
+            net.backprop_tanh(sp, 0.05);
+            net2.train_tanh(in, sp, 0.05, pool);
+            net3.train_tanh(in, sp, 0.05, pool);
+        }
+        out = out && test(0.0, max_param_diff(net, net2), 1E-10, "Failed net data parallel training");
+        out = out && test(true, net2.serialize() == net3.serialize(), "Failed net data parallel training reproducible");
+    }
+    {
+        // Hogwild training on one thread is plain sequential backprop
+        mml::nnet<double, 2, 1> net;
+        net.add_layer(6);
+        net.finalize();
+        net.set_linear_output(true);
+        nnet_init(net);
+        mml::nnet<double, 2, 1> net2 = net;
+        mml::nnet<double, 2, 1> net3 = net;
+        std::vector<mml::vector<double, 2>> in;
+        std::vector<mml::vector<double, 1>> sp;
+        nnet_grid(8, in, sp, std::plus<double>());
+        mml::thread_pool serial(1);
+        for (size_t i = 0; i < 64; i++)
+        {
+            net.set_input(in[i]);
+            net.calculate_sigmoid();
+            net.backprop_sigmoid(sp[i], 0.05);
+        }
+        net2.hogwild_sigmoid(in, sp, 0.05, serial);
+        out = out && test(0.0, max_param_diff(net, net2), 1E-12, "Failed net hogwild single thread");
+
+        // Publishing every sample gives the same result
+        mml::nnet<double, 2, 1> net4 = net3;
+        net4.set_hogwild_interval(1);
+        net4.hogwild_sigmoid(in, sp, 0.05, serial);
+        out = out && test(0.0, max_param_diff(net, net4), 1E-12, "Failed net hogwild single thread interval");
+
+        // Asynchronous training on a shared net still converges
+        mml::thread_pool pool(4);
+        for (size_t i = 0; i < 2000; i++)
+        {
+            net3.hogwild_sigmoid(in, sp, 0.05, pool);
+        }
+        const std::vector<mml::vector<double, 1>> output = net3.calculate_sigmoid(in);
+        const double total_error = nnet_error(output, sp);
+        out = out && test(0.0, total_error, 5E-2, "Failed neural net hogwild training z=x+y");
+    }
+    {
+        // Per layer activations, backprop matches a finite difference gradient
+        mml::nnet<double, 3, 2> net;
+        net.add_layer(5, mml::nnactivation::gelu);
+        net.add_layer(4, mml::nnactivation::leaky_relu);
+        net.add_layer(4, mml::nnactivation::softplus);
+        net.finalize(mml::nnactivation::tanh);
+        net.randomize(rng);
+        const double x[3] = {0.3, -0.7, 0.2};
+        const double t[2] = {0.25, -0.5};
+        const mml::vector<double, 3> input(x);
+        const mml::vector<double, 2> sp(t);
+        const auto loss = [&input, &sp](mml::nnet<double, 3, 2> n, const std::vector<double> &data) {
+            n.deserialize(data);
+            n.set_input(input);
+            return 0.5 * (n.calculate() - sp).square_magnitude();
+        };
+        const std::vector<double> d0 = net.serialize();
+        mml::nnet<double, 3, 2> net2 = net;
+        net2.set_input(input);
+        net2.calculate();
+        net2.backprop(sp, 1E-3);
+        const std::vector<double> d1 = net2.serialize();
+        double error = 0.0;
+        for (size_t k = 8; k < d0.size() - 4; k += 3)
+        {
+            std::vector<double> up = d0;
+            std::vector<double> down = d0;
+            up[k] += 1E-6;
+            down[k] -= 1E-6;
+            const double fd = (loss(net, up) - loss(net, down)) / 2E-6;
+            error = std::max(error, std::abs(fd - (d0[k] - d1[k]) / 1E-3));
+        }
+        out = out && test(0.0, error, 1E-6, "Failed net per layer activation gradient");
+
+        // Activation codes trail the weights, a fresh net restores them
+        mml::nnet<double, 3, 2> net3;
+        net3.deserialize(d0);
+        net3.set_input(input);
+        net.set_input(input);
+        const mml::vector<double, 2> y = net.calculate();
+        const mml::vector<double, 2> y3 = net3.calculate();
+        out = out && test(true, d0 == net3.serialize(), "Failed net per layer activation serialize");
+        out = out && test(y[0], y3[0], 1E-15, "Failed net per layer activation deserialize");
+        out = out && test(y[1], y3[1], 1E-15, "Failed net per layer activation deserialize");
+
+        // Data without activation codes loads with inherited activations
+        const std::vector<double> legacy(d0.begin(), d0.end() - 4);
+        mml::nnet<double, 3, 2> net4;
+        net4.deserialize(legacy);
+        out = out && test(true, legacy == net4.serialize(), "Failed net inherited activation serialize");
+    }
+    {
+        // A net without hidden layers is a linear model and fits z = x + y exactly
+        mml::nnet<double, 2, 1> net;
+        net.finalize();
+        nnet_init(net);
+        std::vector<mml::vector<double, 2>> in;
+        std::vector<mml::vector<double, 1>> sp;
+        nnet_grid(8, in, sp, std::plus<double>());
+        for (size_t i = 0; i < 200; i++)
+        {
+            for (size_t j = 0; j < 64; j++)
+            {
+                net.set_input(in[j]);
+                net.calculate_identity();
+                net.backprop_identity(sp[j], 0.1);
+            }
+        }
+        const std::vector<mml::vector<double, 1>> output = net.calculate_identity(in);
+        const double total_error = nnet_error(output, sp);
+        out = out && test(0.0, total_error, 1E-12, "Failed neural net single layer training z=x+y");
+    }
+    {
+        // Train z = x + y with rectified linear hidden layers and a linear output layer
+        mml::nnet<double, 2, 1> net;
+        net.add_layer(8, mml::nnactivation::relu);
+        net.add_layer(8, mml::nnactivation::relu);
+        net.finalize(mml::nnactivation::identity);
+        nnet_init(net);
+        std::vector<mml::vector<double, 2>> in;
+        std::vector<mml::vector<double, 1>> sp;
+        nnet_grid(8, in, sp, std::plus<double>());
+        for (size_t i = 0; i < 6000; i++)
+        {
+            net.calculate(in);
+            net.backprop(sp, 0.2);
+        }
+        const std::vector<mml::vector<double, 1>> output = net.calculate(in);
+        const double total_error = nnet_error(output, sp);
+        out = out && test(0.0, total_error, 2E-3, "Failed neural net relu training z=x+y");
+    }
+    {
+        // The first adam step moves every parameter by about the step size against the gradient sign
+        mml::nnet<double, 2, 1> net;
+        net.add_layer(4, mml::nnactivation::tanh);
+        net.finalize(mml::nnactivation::identity);
+        net.randomize(rng);
+        mml::nnet<double, 2, 1> net2 = net;
+        net2.set_adam();
+        const double x[2] = {0.4, -0.3};
+        net.set_input(mml::vector<double, 2>(x));
+        net2.set_input(mml::vector<double, 2>(x));
+        const std::vector<double> d0 = net.serialize();
+        net.calculate();
+        net.backprop(mml::vector<double, 1>(1.0), 1E-3);
+        net2.calculate();
+        net2.backprop(mml::vector<double, 1>(1.0), 1E-3);
+        const std::vector<double> sgd = net.serialize();
+        const std::vector<double> adam = net2.serialize();
+        double error = 0.0;
+        for (size_t i = 3; i < d0.size(); i++)
+        {
+            const double g = (d0[i] - sgd[i]) / 1E-3;
+            const double expect = 1E-3 * g / (std::abs(g) + 1E-8);
+            error = std::max(error, std::abs(d0[i] - adam[i] - expect));
+        }
+        out = out && test(0.0, error, 1E-9, "Failed net adam first step");
+    }
+    {
+        // Adaptive and momentum optimizers reach a lower loss than plain sgd in the same epochs
+        mml::nnet<double, 2, 1> base;
+        base.add_layer(8, mml::nnactivation::tanh);
+        base.add_layer(8, mml::nnactivation::tanh);
+        base.finalize(mml::nnactivation::identity);
+        nnet_init(base);
+        std::vector<mml::vector<double, 2>> in;
+        std::vector<mml::vector<double, 1>> sp;
+        nnet_grid(8, in, sp, std::multiplies<double>());
+        const auto train = [&base, &in, &sp](void (*method)(mml::nnet<double, 2, 1> &), const double step) {
+            mml::nnet<double, 2, 1> net = base;
+            method(net);
+            for (size_t i = 0; i < 300; i++)
+            {
+                net.calculate(in);
+                net.backprop(sp, step);
+            }
+            const std::vector<mml::vector<double, 1>> output = net.calculate(in);
+            const double total_error = nnet_error(output, sp);
+            return total_error;
+        };
+        const double sgd = train([](mml::nnet<double, 2, 1> &n) { n.set_sgd(); }, 0.1);
+        const double momentum = train([](mml::nnet<double, 2, 1> &n) { n.set_momentum(0.9); }, 0.1);
+        const double nesterov = train([](mml::nnet<double, 2, 1> &n) { n.set_momentum(0.9, true); }, 0.1);
+        const double rmsprop = train([](mml::nnet<double, 2, 1> &n) { n.set_rmsprop(); }, 0.01);
+        const double adam = train([](mml::nnet<double, 2, 1> &n) { n.set_adam(); }, 0.01);
+        const double adamw = train([](mml::nnet<double, 2, 1> &n) { n.set_adamw(1E-4); }, 0.01);
+        out = out && test(true, momentum < sgd, "Failed net momentum optimizer");
+        out = out && test(true, nesterov < sgd, "Failed net nesterov optimizer");
+        out = out && test(true, rmsprop < sgd, "Failed net rmsprop optimizer");
+        out = out && test(true, adam < sgd, "Failed net adam optimizer");
+        out = out && test(true, adamw < sgd, "Failed net adamw optimizer");
+    }
+
     // return result
     return out;
 }
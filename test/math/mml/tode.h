@@ -0,0 +1,107 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __TESTODE__
+#define __TESTODE__
+
+#include <cmath>
+#include <mml/mat.h>
+#include <mml/ode.h>
+#include <mml/test.h>
+#include <mml/vec.h>
+
+// Robertson chemical kinetics, stiffness ratio around 1E11
+mml::vector<double, 3> o1(const double t, const mml::vector<double, 3> &y)
+{
+    mml::vector<double, 3> out;
+    out[0] = -0.04 * y[0] + 1E4 * y[1] * y[2];
+    out[1] = 0.04 * y[0] - 1E4 * y[1] * y[2] - 3E7 * y[1] * y[1];
+    out[2] = 3E7 * y[1] * y[1];
+    return out;
+}
+mml::matrix<double, 3, 3> o1_jacobian(const double t, const mml::vector<double, 3> &y)
+{
+    mml::matrix<double, 3, 3> out;
+    out.get(0, 0) = -0.04;
+    out.get(0, 1) = 1E4 * y[2];
+    out.get(0, 2) = 1E4 * y[1];
+    out.get(1, 0) = 0.04;
+    out.get(1, 1) = -1E4 * y[2] - 6E7 * y[1];
+    out.get(1, 2) = -1E4 * y[1];
+    out.get(2, 0) = 0.0;
+    out.get(2, 1) = 6E7 * y[1];
+    out.get(2, 2) = 0.0;
+    return out;
+}
+// Stiff scalar problem relaxing onto y = cos(t)
+mml::vector<double, 1> o2(const double t, const mml::vector<double, 1> &y)
+{
+    return mml::vector<double, 1>(-1000.0 * (y[0] - std::cos(t)) - std::sin(t));
+}
+
+bool test_ode()
+{
+    bool out = true;
+
+    // Test bdf on the robertson problem with a finite difference jacobian
+    {
+        mml::vector<double, 3> y0;
+        y0[0] = 1.0;
+        mml::bdf<double, 3> solver(o1, 0.0, y0);
+        solver.set_tolerance(1E-6, 1E-10);
+        const mml::vector<double, 3> y = solver.integrate(40.0);
+        out = out && test(0.7158271, y[0], 1E-5, "Failed bdf robertson y0");
+        out = out && test(9.185535E-6, y[1], 1E-9, "Failed bdf robertson y1");
+        out = out && test(0.2841729, y[2], 1E-5, "Failed bdf robertson y2");
+        out = out && test(true, solver.get_jacobians() * 10 < solver.get_steps(), "Failed bdf jacobian reuse");
+        out = out && test(true, solver.get_order() > 1, "Failed bdf order selection");
+    }
+
+    // Test rosenbrock on the robertson problem with an analytic jacobian
+    {
+        mml::vector<double, 3> y0;
+        y0[0] = 1.0;
+        mml::rosenbrock<double, 3> solver(o1, 0.0, y0);
+        solver.set_jacobian(o1_jacobian);
+        solver.set_tolerance(1E-6, 1E-10);
+        const mml::vector<double, 3> y = solver.integrate(40.0);
+        out = out && test(0.7158271, y[0], 1E-4, "Failed rosenbrock robertson y0");
+        out = out && test(9.185535E-6, y[1], 1E-8, "Failed rosenbrock robertson y1");
+        out = out && test(0.2841729, y[2], 1E-4, "Failed rosenbrock robertson y2");
+        out = out && test(true, solver.get_jacobians() < solver.get_steps(), "Failed rosenbrock jacobian reuse");
+        out = out && test(true, solver.get_factorizations() < solver.get_steps(), "Failed rosenbrock factorization reuse");
+    }
+
+    // Test dense output against the exact solution in the middle of steps
+    {
+        const mml::vector<double, 1> y0(2.0);
+        mml::bdf<double, 1> b(o2, 0.0, y0);
+        mml::rosenbrock<double, 1> r(o2, 0.0, y0);
+        b.set_tolerance(1E-8, 1E-8);
+        r.set_tolerance(1E-4, 1E-4);
+        for (size_t i = 1; i <= 20; i++)
+        {
+            const double t = 0.25 * i;
+            out = out && test(std::cos(t), b.integrate(t)[0], 1E-6, "Failed bdf dense output");
+            out = out && test(std::cos(t), r.integrate(t)[0], 1E-4, "Failed rosenbrock dense output");
+        }
+        out = out && test(true, b.get_steps() < 500, "Failed bdf stiff step count");
+        out = out && test(true, r.get_steps() < 500, "Failed rosenbrock stiff step count");
+        out = out && test(true, r.get_jacobians() * 10 < r.get_steps(), "Failed rosenbrock stiff jacobian reuse");
+    }
+
+    return out;
+}
+
+#endif
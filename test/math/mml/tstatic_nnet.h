@@ -0,0 +1,135 @@
+/* Copyright [2013-2016] [Aaron Springstroh, Minimal Math Library]
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef __TESTSTATICNNET__
+#define __TESTSTATICNNET__
+
+#include <cmath>
+#include <mml/nnet.h>
+#include <mml/static_nnet.h>
+#include <mml/test.h>
+#include <mml/vec.h>
+#include <stdexcept>
+#include <vector>
+
+bool test_static_nnet()
+{
+    bool out = true;
+    mml::net_rng<double> rng;
+
+    // Test a static net loaded from a trained nnet gives the same output
+    {
+        mml::nnet<double, 3, 2> net;
+        net.add_layer(5);
+        net.add_layer(4);
+        net.finalize();
+        net.randomize(rng);
+        const std::vector<double> data = net.serialize();
+        mml::static_nnet<double, 3, 5, 4, 2> fixed(data);
+        for (size_t i = 0; i < 10; i++)
+        {
+            const double x[3] = {0.1 * i, -0.05 * i, 0.3};
+            const mml::vector<double, 3> input(x);
+            net.set_input(input);
+            const mml::vector<double, 2> t1 = net.calculate_tanh();
+            const mml::vector<double, 2> t2 = fixed.calculate_tanh(input);
+            out = out && test(t1[0], t2[0], 1E-12, "Failed static net tanh");
+            out = out && test(t1[1], t2[1], 1E-12, "Failed static net tanh");
+            const mml::vector<double, 2> s1 = net.calculate_sigmoid();
+            const mml::vector<double, 2> s2 = fixed.calculate_sigmoid(input);
+            out = out && test(s1[0], s2[0], 1E-12, "Failed static net sigmoid");
+            out = out && test(s1[1], s2[1], 1E-12, "Failed static net sigmoid");
+            const mml::vector<double, 2> r1 = net.calculate_relu();
+            const mml::vector<double, 2> r2 = fixed.calculate_relu(input);
+            out = out && test(r1[0], r2[0], 1E-12, "Failed static net relu");
+            out = out && test(r1[1], r2[1], 1E-12, "Failed static net relu");
+        }
+
+        // Linear output node
+        net.set_linear_output(true);
+        fixed.set_linear_output(true);
+        const double x[3] = {0.2, 0.4, -0.6};
+        net.set_input(mml::vector<double, 3>(x));
+        const mml::vector<double, 2> l1 = net.calculate_sigmoid();
+        const mml::vector<double, 2> l2 = fixed.calculate_sigmoid(mml::vector<double, 3>(x));
+        out = out && test(l1[0], l2[0], 1E-12, "Failed static net linear output");
+        out = out && test(l1[1], l2[1], 1E-12, "Failed static net linear output");
+
+        // Serialize round trip
+        out = out && test(true, fixed.serialize() == data, "Failed static net serialize");
+    }
+
+    // Test a net without hidden layers is one activated matrix product
+    {
+        mml::nnet<double, 3, 2> net;
+        net.finalize();
+        net.randomize(rng);
+        const std::vector<double> data = net.serialize();
+        mml::static_nnet<double, 3, 2> fixed(data);
+        const double x[3] = {0.2, 0.4, -0.6};
+        const mml::vector<double, 2> y = fixed.calculate_tanh(mml::vector<double, 3>(x));
+        for (size_t i = 0; i < 2; i++)
+        {
+            // Weights and bias of node i follow the header
+            const double *const w = &data[4 + i * 4];
+            const double expect = std::tanh(w[0] * x[0] + w[1] * x[1] + w[2] * x[2] + w[3]);
+            out = out && test(expect, y[i], 1E-12, "Failed static net single layer");
+        }
+        out = out && test(true, fixed.serialize() == data, "Failed static net single layer serialize");
+
+        // nnet evaluates the same net
+        net.set_input(mml::vector<double, 3>(x));
+        const mml::vector<double, 2> y1 = net.calculate_tanh();
+        out = out && test(y1[0], y[0], 1E-12, "Failed static net single layer nnet");
+        out = out && test(y1[1], y[1], 1E-12, "Failed static net single layer nnet");
+    }
+
+    // Test loading a net with per layer activations fails
+    {
+        mml::nnet<double, 3, 2> net;
+        net.add_layer(5, mml::nnactivation::gelu);
+        net.finalize();
+        bool thrown = false;
+        try
+        {
+            mml::static_nnet<double, 3, 5, 2> fixed(net.serialize());
+        }
+        catch (std::exception &e)
+        {
+            thrown = true;
+        }
+        out = out && test(true, thrown, "Failed static net per layer activation check");
+    }
+
+    // Test loading a net with a different topology fails
+    {
+        mml::nnet<double, 3, 2> net;
+        net.add_layer(6);
+        net.finalize();
+        bool thrown = false;
+        try
+        {
+            mml::static_nnet<double, 3, 5, 2> fixed(net.serialize());
+        }
+        catch (std::exception &e)
+        {
+            thrown = true;
+        }
+        out = out && test(true, thrown, "Failed static net topology check");
+    }
+
+    return out;
+}
+
+#endif
@@ -15,6 +15,7 @@ limitations under the License.
 #ifndef __TESTSYSTEM__
 #define __TESTSYSTEM__
 
+#include <cmath>
 #include <mml/equation.h>
 #include <mml/numeric.h>
 #include <mml/system.h>
@@ -36,6 +37,33 @@ double f3(const mml::vector<double, 3> &x)
     return x[0] - 4.0 * x[1] + x[2] - 18;
 }
 
+// Newton diverges on atan far from the root at (1, -2, -2)
+double f4(const mml::vector<double, 3> &x)
+{
+    return std::atan(x[0] - 1.0);
+}
+
+double f5(const mml::vector<double, 3> &x)
+{
+    return std::atan(x[1] + 2.0);
+}
+
+double f6(const mml::vector<double, 3> &x)
+{
+    return x[2] - x[0] * x[1];
+}
+
+// Rank deficient linear system, the first two rows of the jacobian are equal
+double f7(const mml::vector<double, 3> &x)
+{
+    return x[0] + x[1] - 2.0;
+}
+
+double f8(const mml::vector<double, 3> &x)
+{
+    return x[2] - 3.0;
+}
+
 bool test_system()
 {
     bool out = true;
@@ -163,6 +191,74 @@ bool test_system()
         out = out && test(3.0, x1[2], 1E-4, "Failed matrix forward zero");
     }
 
+    // Globalized newton test
+    {
+        // Create equation array
+        mml::equation<double, 3, mml::center> eqs[3] = {f4, f5, f6};
+
+        // Create system of equations
+        mml::system<double, 3, mml::center> system(eqs);
+        system.set_tolerance(1E-8);
+
+        // Start far from the root
+        mml::vector<double, 3> x0(10.0);
+        mml::vector<double, 3> x1;
+
+        // Test full newton step diverges, few iterations keep the residual finite
+        system.set_max_iterations(2);
+        double convergence = system.zero(x0, x1);
+        out = out && test(true, convergence > 1.0, "Failed system newton divergence");
+        system.set_max_iterations(100);
+
+        // Test line search
+        system.set_line_search();
+        convergence = system.zero(x0, x1);
+        out = out && test(0.0, convergence, 1E-8, "Failed system line search zero");
+        out = out && test(1.0, x1[0], 1E-4, "Failed system line search zero");
+        out = out && test(-2.0, x1[1], 1E-4, "Failed system line search zero");
+        out = out && test(-2.0, x1[2], 1E-4, "Failed system line search zero");
+
+        // Test dogleg
+        system.set_dogleg();
+        convergence = system.zero(x0, x1);
+        out = out && test(0.0, convergence, 1E-8, "Failed system dogleg zero");
+        out = out && test(1.0, x1[0], 1E-4, "Failed system dogleg zero");
+        out = out && test(-2.0, x1[1], 1E-4, "Failed system dogleg zero");
+        out = out && test(-2.0, x1[2], 1E-4, "Failed system dogleg zero");
+
+        // Test linear system converges in the first step with globalization
+        mml::equation<double, 3, mml::center> lin[3] = {f1, f2, f3};
+        mml::system<double, 3, mml::center> linear(lin);
+        linear.set_dogleg();
+        convergence = linear.zero(x0, x1);
+        out = out && test(0.0, convergence, 1E-7, "Failed system dogleg linear zero");
+        out = out && test(3.0, x1[2], 1E-4, "Failed system dogleg linear zero");
+    }
+
+    // Dogleg with a singular jacobian
+    {
+        mml::equation<double, 3, mml::center> eqs[3] = {f7, f7, f8};
+        mml::system<double, 3, mml::center> system(eqs);
+        system.set_dogleg();
+        system.set_tolerance(1E-8);
+        mml::vector<double, 3> x0(10.0);
+        mml::vector<double, 3> x1;
+
+        // Test the first step is the cauchy point when it is inside the trust region
+        system.set_max_iterations(1);
+        system.zero(x0, x1);
+        const double t = 2641.0 / 10417.0;
+        out = out && test(10.0 - 36.0 * t, x1[0], 1E-5, "Failed system dogleg singular cauchy point");
+        out = out && test(10.0 - 7.0 * t, x1[2], 1E-5, "Failed system dogleg singular cauchy point");
+
+        // Test cauchy steps reach a zero of the consistent system
+        system.set_max_iterations(100);
+        const double convergence = system.zero(x0, x1);
+        out = out && test(0.0, convergence, 1E-8, "Failed system dogleg singular zero");
+        out = out && test(2.0, x1[0] + x1[1], 1E-4, "Failed system dogleg singular zero");
+        out = out && test(3.0, x1[2], 1E-4, "Failed system dogleg singular zero");
+    }
+
     return out;
 }
 
@@ -95,6 +95,11 @@ bool test_vector()
     v2[1] = 8.0;
     out = out && test(100.0, v2.square_magnitude(), 1E-4, "Failed vector square magnitude");
 
+    // Test dot product
+    v1[0] = 2.0;
+    v1[1] = -1.0;
+    out = out && test(4.0, v1.dot(v2), 1E-4, "Failed vector dot product");
+
     return out;
 }
 
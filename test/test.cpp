@@ -13,12 +13,22 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <iostream>
+#include <mml/tactivation.h>
+#include <mml/tanderson.h>
+#include <mml/tbatch.h>
+#include <mml/tcmaes.h>
+#include <mml/tdifferential.h>
+#include <mml/tensemble.h>
 #include <mml/tequation.h>
 #include <mml/tevolution_neat.h>
+#include <mml/tlsq.h>
 #include <mml/tmat.h>
 #include <mml/tmult.h>
+#include <mml/tmultistart.h>
 #include <mml/tneat.h>
 #include <mml/tnnet.h>
+#include <mml/tode.h>
+#include <mml/tstatic_nnet.h>
 #include <mml/tsystem.h>
 #include <mml/tvec.h>
 
@@ -35,6 +45,16 @@ int main()
         out = out && test_matrix_multiply();
         out = out && test_equation();
         out = out && test_system();
+        out = out && test_least_squares();
+        out = out && test_multistart();
+        out = out && test_cmaes();
+        out = out && test_differential();
+        out = out && test_batch();
+        out = out && test_anderson();
+        out = out && test_ode();
+        out = out && test_ensemble();
+        out = out && test_activation();
+        out = out && test_static_nnet();
         if (out)
         {
             std::cout << "Math tests passed!" << std::endl;